@@ -0,0 +1,95 @@
+//
+//  EcoCab.h
+//
+//  Cheap cab: a cascade of biquads fitted offline to each IR (host/ir_fit,
+//  data in ir_eco_data.h). ~5 MACs per section instead of one per IR tap,
+//  e.g. 60 for 12 sections against 400+ for the FIR. It only matches the
+//  magnitude response and is minimum phase, so it's for when the cycles are
+//  needed elsewhere (heavy models, battery), not the default.
+//
+//  Transposed direct form II, one coefficient set per side, double buffered
+//  like ImpulseResponse::SetKernel(): Set() from the control context, the audio
+//  thread picks it up in ApplyPending().
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <string.h>
+
+#define ECO_MAX_SECTIONS 16
+
+struct EcoCabData
+{
+  size_t sections;
+  float coef[ECO_MAX_SECTIONS][5];  // b0, b1, b2, a1, a2
+};
+
+class EcoCab
+{
+public:
+  // Control context, no allocation. right may be null or empty for a mono cab.
+  // False while the previous change hasn't been picked up yet.
+  bool Set(const EcoCabData& left, const EcoCabData* right)
+  {
+    if (mPending.load(std::memory_order_acquire))
+      return false;
+    mNext[0] = left;
+    mNextStereo = right && right->sections > 0;
+    mNext[1] = mNextStereo ? *right : left;
+    mPending.store(true, std::memory_order_release);
+    return true;
+  }
+
+  // Audio thread, once per block
+  void ApplyPending()
+  {
+    if (!mPending.load(std::memory_order_acquire))
+      return;
+    mData[0] = mNext[0];
+    mData[1] = mNext[1];
+    mStereo = mNextStereo;
+    mPending.store(false, std::memory_order_release);
+  }
+
+  void Reset()
+  {
+    memset(mState, 0, sizeof(mState));
+  }
+
+  bool IsLoaded() const { return mData[0].sections > 0; }
+
+  float Process(float x)
+  {
+    return _Run(0, x);
+  }
+
+  void ProcessStereo(float x, float& left, float& right)
+  {
+    left = _Run(0, x);
+    right = mStereo ? _Run(1, x) : left;
+  }
+
+private:
+  EcoCabData mData[2] = {};
+  EcoCabData mNext[2];
+  bool mStereo = false;
+  bool mNextStereo = false;
+  std::atomic<bool> mPending{false};
+  float mState[2][ECO_MAX_SECTIONS][2] = {};
+
+  float _Run(int side, float x)
+  {
+    const EcoCabData& d = mData[side];
+    float (*z)[2] = mState[side];
+    for (size_t s = 0; s < d.sections; s++)
+    {
+      const float* c = d.coef[s];
+      const float y = c[0] * x + z[s][0];
+      z[s][0] = c[1] * x - c[3] * y + z[s][1];
+      z[s][1] = c[2] * x - c[4] * y;
+      x = y;
+    }
+    return x;
+  }
+};
@@ -13,6 +13,10 @@
 
 ImpulseResponse::ImpulseResponse()
 {
+  // Fixed window, see IR_MAX_LENGTH
+  mHistoryRequired = IR_MAX_LENGTH - 1;
+  mHistorySize = std::min((size_t)(5 * mHistoryRequired), (size_t)HISTORY_MAX_SIZE);
+  Reset();
 }
 
 // Destructor
@@ -22,46 +26,220 @@ ImpulseResponse::~ImpulseResponse()
 }
 
 
-void ImpulseResponse::Init(std::vector<float> irData)
+void ImpulseResponse::Init(const std::vector<float>& irData)
 {
-  mRawAudio = irData;
-  _SetWeights();
+  Init(irData.data(), nullptr, irData.size());
+}
+
+void ImpulseResponse::Init(const float* irData, size_t length)
+{
+  Init(irData, nullptr, length);
+}
+
+void ImpulseResponse::Init(const float* irLeft, const float* irRight, size_t length)
+{
+  if (!mStore)
+    return;
+  mShared = nullptr;
+  mFadeRemaining = 0;
+  mKernelState.store(0);
+  _SetWeights(irLeft, irRight, length);
+}
+
+void ImpulseResponse::Init(const ImpulseResponse& shared)
+{
+  const int b = shared.mActive;
+  mShared = shared._Kernel(b);
+  mLength[0] = mLength[1] = shared.mLength[b];
+  mStereo[0] = mStereo[1] = shared.mStereo[b];
+  mFadeRemaining = 0;
+  mKernelState.store(0);
+
+  mTaps = mTapsFrom = IR_MAX_LENGTH;
+  mTrimFade = 0;
+  Reset();
+}
+
+bool ImpulseResponse::SetKernel(const float* irData, size_t length)
+{
+  return SetKernel(irData, nullptr, length);
+}
+
+bool ImpulseResponse::SetKernel(const float* irLeft, const float* irRight, size_t length)
+{
+  if (mShared || !mStore || mKernelState.load(std::memory_order_acquire) != 0)
+    return false;
+
+  // Kernel, length and layout all land in the inactive buffer before the release
+  _WriteKernel(mActive ^ 1, irLeft, irRight, length);
+
+  mKernelState.store(1, std::memory_order_release);
+  return true;
+}
+
+void ImpulseResponse::ApplyPendingKernel()
+{
+  if (mKernelState.load(std::memory_order_acquire) != 1)
+    return;
+  mActive ^= 1;
+  mFadeRemaining = IR_XFADE_SAMPLES;
+  mKernelState.store(2, std::memory_order_relaxed);
+}
+
+void ImpulseResponse::SettleKernel()
+{
+  if (mFadeRemaining == 0)
+    return;
+  mFadeRemaining = 0;
+  mKernelState.store(0, std::memory_order_release);
+}
+
+void ImpulseResponse::SetTrim(size_t taps)
+{
+  if (taps == 0 || taps > IR_MAX_LENGTH)
+    taps = IR_MAX_LENGTH;
+  if (taps == mTaps)
+    return;
+  mTapsFrom = mTaps;
+  mTaps = taps;
+  mTrimFade = IR_XFADE_SAMPLES;
+}
+
+void ImpulseResponse::Reset()
+{
+  std::fill(mHistory, mHistory + mHistorySize, 0.0f);
+  mHistoryIndex = mHistoryRequired;
 }
 
 float ImpulseResponse::Process(float inputs)
 {
+  // Mono kernels give the same on both sides, so this is exact for them
+  const Eigen::Vector2f out = _Step(inputs);
+  return 0.5f * (out[0] + out[1]);
+}
 
+void ImpulseResponse::ProcessStereo(float inputs, float& left, float& right)
+{
+  const Eigen::Vector2f out = _Step(inputs);
+  left = out[0];
+  right = out[1];
+}
+
+Eigen::Vector2f ImpulseResponse::_Step(float inputs)
+{
   _UpdateHistory(inputs);
+  _AdvanceTrim();
 
   int j = mHistoryIndex - mHistoryRequired;
-  auto input = Eigen::Map<const Eigen::VectorXf>(&mHistory[j], mHistoryRequired + 1);
-  
+  const float* input = &mHistory[j];
+
   _AdvanceHistoryIndex(1); // KAB MOD - for Daisy implementation numFrames is always 1
 
-  return (float)mWeight.dot(input);
+  Eigen::Vector2f out = _Output(mActive, input);
+  if (mFadeRemaining > 0)
+  {
+    // Only while a new kernel comes in: also run the old one and crossfade
+    const float t = (float)mFadeRemaining / IR_XFADE_SAMPLES;
+    out += t * (_Output(mActive ^ 1, input) - out);
+    if (--mFadeRemaining == 0)
+      mKernelState.store(0, std::memory_order_release);
+  }
+  return out;
+}
+
+Eigen::Vector2f ImpulseResponse::_Output(int buffer, const float* input) const
+{
+  // Nothing loaded yet
+  if (mLength[buffer] == 0)
+    return Eigen::Vector2f::Zero();
+  if (mStereo[buffer])
+    return _Convolve2(_Kernel(buffer), mLength[buffer], input);
+  const float y = _Convolve(_Kernel(buffer), mLength[buffer], input);
+  return Eigen::Vector2f(y, y);
+}
+
+float ImpulseResponse::_Dot(const float* kernel, const float* input, size_t from, size_t to) const
+{
+  auto x = Eigen::Map<const Eigen::VectorXf>(input + from, to - from);
+  auto w = Eigen::Map<const Eigen::VectorXf>(kernel + from, to - from);
+  return w.dot(x);
+}
+
+Eigen::Vector2f ImpulseResponse::_Dot2(const float* kernel, const float* input, size_t from, size_t to) const
+{
+  typedef Eigen::Map<const Eigen::Matrix<float, 2, Eigen::Dynamic>> StereoKernel;
+  auto x = Eigen::Map<const Eigen::VectorXf>(input + from, to - from);
+  StereoKernel w(kernel + 2 * from, 2, to - from);
+  return w * x;
+}
+
+// The kernel is reversed and ends at the end of the window, so the first
+// `taps` samples of the IR are the last `taps` weights and line up with the
+// newest history. Weights before full - length are never read.
+float ImpulseResponse::_Convolve(const float* kernel, size_t length, const float* input) const
+{
+  const size_t full = IR_MAX_LENGTH;
+  if (mTrimFade == 0)
+    return _Dot(kernel, input, full - std::min(mTaps, length), full);
+  const size_t head = std::min(std::min(mTaps, mTapsFrom), length);
+  const size_t all = std::min(std::max(mTaps, mTapsFrom), length);
+  return _Dot(kernel, input, full - head, full) + mTailGain * _Dot(kernel, input, full - all, full - head);
+}
+
+Eigen::Vector2f ImpulseResponse::_Convolve2(const float* kernel, size_t length, const float* input) const
+{
+  const size_t full = IR_MAX_LENGTH;
+  if (mTrimFade == 0)
+    return _Dot2(kernel, input, full - std::min(mTaps, length), full);
+  const size_t head = std::min(std::min(mTaps, mTapsFrom), length);
+  const size_t all = std::min(std::max(mTaps, mTapsFrom), length);
+  return _Dot2(kernel, input, full - head, full) + mTailGain * _Dot2(kernel, input, full - all, full - head);
+}
 
+void ImpulseResponse::_AdvanceTrim()
+{
+  if (mTrimFade == 0)
+    return;
+  mTrimFade--;
+  // Tail fading in when the trim got longer, out when it got shorter
+  const float t = (float)mTrimFade / IR_XFADE_SAMPLES;
+  mTailGain = mTaps > mTapsFrom ? 1.0f - t : t;
 }
 
-void ImpulseResponse::_SetWeights()
+void ImpulseResponse::_WriteKernel(int buffer, const float* irLeft, const float* irRight, size_t length)
+{
+  const size_t irLength = std::min(length, mMaxLength);
+  const size_t full = IR_MAX_LENGTH;
+  float* weight = mStore->weight[buffer];
+  for (size_t i = 0, j = full - 1; i < irLength; i++, j--)
+  {
+    if (irRight)
+    {
+      weight[2 * j] = irLeft[i];
+      weight[2 * j + 1] = irRight[i];
+    }
+    else
+    {
+      weight[j] = irLeft[i];
+    }
+  }
+  mLength[buffer] = irLength;
+  mStereo[buffer] = irRight != nullptr;
+}
+
+void ImpulseResponse::_SetWeights(const float* irLeft, const float* irRight, size_t length)
 {
 
-  const size_t irLength = std::min(mRawAudio.size(), mMaxLength);
-  mWeight.resize(irLength);
   // Gain reduction.
   // https://github.com/sdatkinson/NeuralAmpModelerPlugin/issues/100#issuecomment-1455273839
   // Add sample rate-dependence
   //const float gain = pow(10, -18 * 0.05) * 48000 / mSampleRate;  //KAB NOTE: This made a very bad/loud sound on Daisy Seed
-  for (size_t i = 0, j = irLength - 1; i < irLength; i++, j--)
-    //mWeight[j] = gain * mRawAudio[i];  
-    mWeight[j] = mRawAudio[i];
-  mHistoryRequired = irLength - 1;
-
-  // Moved from HISTORY::EnsureHistorySize since only doing once for this module (assuming same size IR's)
-  //   TODO: Maybe find a more efficient method of indexing mHistory,
-  //         rather than copying the end of the vector (length of IR) back to the beginning all at once.
-  const size_t requiredHistoryArraySize = 5 * mHistoryRequired; // Just so we don't spend too much time copying back. // KAB NOTE: was 10 *
-  mHistory.resize(requiredHistoryArraySize);
-  std::fill(mHistory.begin(), mHistory.end(), 0.0f);
-  mHistoryIndex = mHistoryRequired; 
+  mTaps = mTapsFrom = IR_MAX_LENGTH;
+  mTrimFade = 0;
+  _WriteKernel(mActive, irLeft, irRight, length);
+
+  // The history window is fixed at IR_MAX_LENGTH (see the constructor), only
+  // clear it
+  Reset();
 
 }
@@ -13,8 +13,27 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <atomic>
+#include <vector>
 #include "dsp.h"
 
+// Longest IR kept, the rest is truncated. Sized for the time domain convolution
+// the Daisy can afford, and so kernel + history fit in DTCM. The history window
+// is always this long, whatever the kernel's length, so a kernel of another
+// length only changes how many taps are convolved, never the history indexing.
+#define IR_MAX_LENGTH 1024
+// Crossfade between the old and new kernel after SetKernel(), and of the tail
+// after SetTrim()
+#define IR_XFADE_SAMPLES 64
+
+// Weights of an instance with a kernel of its own. Double buffered for
+// SetKernel(), room for a stereo pair in each. Kept outside the instance so the
+// caller can place it (DTCM on the Daisy), and so instances that run on a shared
+// kernel carry none.
+struct IrKernelStore
+{
+  float weight[2][2 * IR_MAX_LENGTH];
+};
 
 class ImpulseResponse : public History
 {
@@ -22,24 +41,93 @@ public:
   ImpulseResponse();
   ~ImpulseResponse();
 
-  void Init(std::vector<float> irData);
+  // Storage for a kernel of its own, before the Init()s that take one and
+  // SetKernel(); those do nothing without it. Must outlive the instance.
+  void SetStore(IrKernelStore* store) { mStore = store; }
+  // Setup only, before the audio thread runs; use SetKernel() afterwards.
+  void Init(const std::vector<float>& irData);
+  void Init(const float* irData, size_t length);
+  // Stereo/dual-mic pair: both kernels run on the same input history.
+  // irRight may be null for a mono IR.
+  void Init(const float* irLeft, const float* irRight, size_t length);
+  // Run on another instance's kernel instead of a private copy (many instances of
+  // the same IR on a host), no store needed. Only the history is per instance.
+  // The source must be initialised, outlive this one and not change its kernel
+  // while shared; SetKernel() is refused on a sharing instance.
+  void Init(const ImpulseResponse& shared);
   float Process(float inputs);
+  // Both kernels in one pass over the history, each history sample is loaded
+  // once for the two MACs. A mono IR gives the same output on both sides.
+  void ProcessStereo(float inputs, float& left, float& right);
+  // Clear the history without touching the weights, no allocation
+  void Reset();
+  bool IsStereo() const { return mStereo[mActive]; }
+
+  // Glitch-free kernel change from the control context, no allocation.
+  // The kernel, its length (up to IR_MAX_LENGTH) and whether it's a stereo pair
+  // go into the inactive weight buffer together and are crossfaded in by the
+  // audio thread, so an IR of another length or channel count loads the same way.
+  // Returns false while the previous change is still being applied, and without
+  // a store.
+  bool SetKernel(const float* irData, size_t length);
+  bool SetKernel(const float* irLeft, const float* irRight, size_t length);
+  // Audio thread, once per block: pick up a kernel published by SetKernel()
+  void ApplyPendingKernel();
+  // Audio thread, for a block the convolver doesn't run: end a kernel
+  // crossfade now, so the next SetKernel() isn't refused meanwhile
+  void SettleKernel();
+  // Audio thread: convolve with only the first `taps` samples of the kernel
+  // (0 = all of it), to save time under load. The cut tail fades out/in.
+  void SetTrim(size_t taps);
 
 
 private:
   // Set the weights, given that the plugin is running at the provided sample
   // rate.
-  void _SetWeights();
+  void _SetWeights(const float* irLeft, const float* irRight, size_t length);
+  // Reversed kernel into weight buffer `buffer`, along with its length and
+  // layout: mono contiguous, stereo as interleaved L/R pairs (a column-major
+  // 2 x N matrix). The kernel ends at the end of the buffer, lined up with the
+  // newest history sample.
+  void _WriteKernel(int buffer, const float* irLeft, const float* irRight, size_t length);
+  // Kernel the audio thread convolves with
+  const float* _Kernel(int buffer) const { return mShared ? mShared : mStore->weight[buffer]; }
+  // Dot product of kernel taps [from, to) with the history window at `input`
+  // (index 0 = the oldest sample, the reversed kernel lines up with it)
+  float _Dot(const float* kernel, const float* input, size_t from, size_t to) const;
+  Eigen::Vector2f _Dot2(const float* kernel, const float* input, size_t from, size_t to) const;
+  // One kernel of `length` over the active taps, with the trimmed tail faded by
+  // mTailGain
+  float _Convolve(const float* kernel, size_t length, const float* input) const;
+  Eigen::Vector2f _Convolve2(const float* kernel, size_t length, const float* input) const;
+  // Both sides from one weight buffer, a mono kernel gives the same on both
+  Eigen::Vector2f _Output(int buffer, const float* input) const;
+  // Per sample: history, trim and kernel crossfade
+  Eigen::Vector2f _Step(float inputs);
+  // Per sample: advance the tail fade
+  void _AdvanceTrim();
 
   // State of audio
-  // Keep a copy of the raw audio that was loaded so that it can be resampled
-  std::vector<float> mRawAudio;
   float mRawAudioSampleRate;
   float mSampleRate;
 
-  const size_t mMaxLength = 8192;
-  // The weights
-  Eigen::VectorXf mWeight;
+  const size_t mMaxLength = IR_MAX_LENGTH;
+  // The weights: our own store or the shared kernel. Each buffer of the store has
+  // its own length and layout.
+  IrKernelStore* mStore = nullptr;
+  size_t mLength[2] = {0, 0};
+  bool mStereo[2] = {false, false};
+  const float* mShared = nullptr;
+  int mActive = 0;
+  // 0 = idle, 1 = new kernel waiting in the inactive buffer, 2 = crossfading
+  std::atomic<int> mKernelState{0};
+  int mFadeRemaining = 0;
+  // Trim: taps convolved (capped by each kernel's length), the count before the
+  // last change, tail fade
+  size_t mTaps = IR_MAX_LENGTH;
+  size_t mTapsFrom = IR_MAX_LENGTH;
+  int mTrimFade = 0;
+  float mTailGain = 0.0f;
 };
 
 
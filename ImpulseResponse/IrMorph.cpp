@@ -0,0 +1,235 @@
+//
+//  IrMorph.cpp
+//
+
+#include "IrMorph.h"
+#include "fft.h"
+
+#include <algorithm>
+#include <math.h>
+
+static size_t _PeakIndex(const std::vector<float>& ir)
+{
+  size_t peak = 0;
+  for (size_t i = 1; i < ir.size(); i++)
+    if (fabsf(ir[i]) > fabsf(ir[peak]))
+      peak = i;
+  return peak;
+}
+
+static void _Shifted(const std::vector<float>& ir, size_t shift, size_t length, float* out)
+{
+  for (size_t i = 0; i < length; i++)
+    out[i] = i >= shift && i - shift < ir.size() ? ir[i - shift] : 0.0f;
+}
+
+void IrMorph::Prepare(const std::vector<float>& irA, const std::vector<float>& irB)
+{
+  const std::vector<float> mono;
+  Prepare(irA, irB, mono, mono);
+}
+
+void IrMorph::Prepare(const std::vector<float>& irA, const std::vector<float>& irB,
+                      const std::vector<float>& irARight, const std::vector<float>& irBRight)
+{
+  BeginPrepare(irA, irB, irARight, irBRight);
+  while (!StepPrepare())
+    ;
+}
+
+void IrMorph::BeginPrepare(const std::vector<float>& irA, const std::vector<float>& irB,
+                           const std::vector<float>& irARight, const std::vector<float>& irBRight)
+{
+  mIrA = &irA;
+  mIrB = &irB;
+  mIrARight = &irARight;
+  mIrBRight = &irBRight;
+  mPrepareStep = 0;
+  // Alignment, then one FFT per kernel
+  mPrepareSteps = !irARight.empty() || !irBRight.empty() ? 5 : 3;
+  mSteps = 0;   // a blend in progress is void
+}
+
+bool IrMorph::StepPrepare()
+{
+  if (mPrepareStep >= mPrepareSteps)
+    return true;
+
+  switch (mPrepareStep)
+  {
+    case 0: _Align(); break;
+    case 1: _LogMagnitude(mA, mLogMagA); break;
+    case 2: _LogMagnitude(mB, mLogMagB); break;
+    case 3: _LogMagnitude(mAR, mLogMagAR); break;
+    case 4: _LogMagnitude(mBR, mLogMagBR); break;
+  }
+  return ++mPrepareStep >= mPrepareSteps;
+}
+
+float IrMorph::PrepareProgress() const
+{
+  return mPrepareSteps > 0 ? (float)mPrepareStep / mPrepareSteps : 1.0f;
+}
+
+void IrMorph::_Align()
+{
+  const std::vector<float>& irA = *mIrA;
+  const std::vector<float>& irB = *mIrB;
+  mStereo = !mIrARight->empty() || !mIrBRight->empty();
+  const std::vector<float>& aRight = mIrARight->empty() ? irA : *mIrARight;
+  const std::vector<float>& bRight = mIrBRight->empty() ? irB : *mIrBRight;
+
+  // Delay the IR with the earlier peak so both main peaks line up
+  const size_t peakA = _PeakIndex(irA), peakB = _PeakIndex(irB);
+  const size_t shiftA = peakB > peakA ? peakB - peakA : 0;
+  const size_t shiftB = peakA > peakB ? peakA - peakB : 0;
+  mLength = std::max(irA.size() + shiftA, irB.size() + shiftB);
+  if (mStereo)
+    mLength = std::max(mLength, std::max(aRight.size() + shiftA, bRight.size() + shiftB));
+  mLength = std::min((size_t)IR_MAX_LENGTH, mLength);
+
+  _Shifted(irA, shiftA, mLength, mA);
+  _Shifted(irB, shiftB, mLength, mB);
+  if (mStereo)
+  {
+    _Shifted(aRight, shiftA, mLength, mAR);
+    _Shifted(bRight, shiftB, mLength, mBR);
+  }
+
+  // Match B's level to A so the blend doesn't change loudness
+  float energyA = 0.0f, energyB = 0.0f;
+  for (size_t i = 0; i < mLength; i++)
+  {
+    energyA += mA[i] * mA[i];
+    energyB += mB[i] * mB[i];
+  }
+  if (energyB > 0.0f)
+  {
+    const float gain = sqrtf(energyA / energyB);
+    for (size_t i = 0; i < mLength; i++)
+    {
+      mB[i] *= gain;
+      if (mStereo)
+        mBR[i] *= gain;
+    }
+  }
+
+  // Room for the minimum phase reconstruction without much time aliasing
+  mFftSize = 1;
+  while (mFftSize < 2 * mLength)
+    mFftSize <<= 1;
+}
+
+void IrMorph::Blend(float amount, Mode mode, float* out, float* outRight)
+{
+  BeginBlend(amount, mode, out, outRight);
+  while (!StepBlend())
+    ;
+}
+
+void IrMorph::BeginBlend(float amount, Mode mode, float* out, float* outRight)
+{
+  mAmount = std::min(1.0f, std::max(0.0f, amount));
+  mMode = mode;
+  mOut = out;
+  mOutRight = mStereo ? outRight : nullptr;
+  mStep = 0;
+  // Time: one step for both sides. Spectral: three FFT stages per side.
+  mSteps = mode == MORPH_TIME ? 1 : (mOutRight ? 6 : 3);
+}
+
+bool IrMorph::StepBlend()
+{
+  if (mStep >= mSteps)
+    return true;
+
+  if (mMode == MORPH_TIME)
+  {
+    for (size_t i = 0; i < mLength; i++)
+      mOut[i] = mA[i] + mAmount * (mB[i] - mA[i]);
+    if (mOutRight)
+      for (size_t i = 0; i < mLength; i++)
+        mOutRight[i] = mAR[i] + mAmount * (mBR[i] - mAR[i]);
+  }
+  else if (mStep < 3)
+    _SpectralStage(mStep, mLogMagA, mLogMagB, mOut);
+  else
+    _SpectralStage(mStep - 3, mLogMagAR, mLogMagBR, mOutRight);
+
+  return ++mStep >= mSteps;
+}
+
+float IrMorph::BlendProgress() const
+{
+  return mSteps > 0 ? (float)mStep / mSteps : 1.0f;
+}
+
+// Stage 0: interpolated log magnitude -> real cepstrum
+// Stage 1: fold onto positive quefrencies (minimum phase) -> back to the spectrum
+// Stage 2: exp -> time domain, written to out
+void IrMorph::_SpectralStage(int stage, const float* logMagA, const float* logMagB, float* out)
+{
+  const size_t n = mFftSize, half = n / 2;
+  if (stage == 0)
+  {
+    for (size_t k = 0; k <= half; k++)
+    {
+      mRe[k] = logMagA[k] + mAmount * (logMagB[k] - logMagA[k]);
+      mIm[k] = 0.0f;
+    }
+    for (size_t k = half + 1; k < n; k++)
+    {
+      mRe[k] = mRe[n - k];
+      mIm[k] = 0.0f;
+    }
+    FFT(mRe, mIm, n, true);
+  }
+  else if (stage == 1)
+  {
+    mRe[0] /= n;
+    mIm[0] = 0.0f;
+    for (size_t k = 1; k < half; k++)
+    {
+      mRe[k] *= 2.0f / n;
+      mIm[k] = 0.0f;
+    }
+    mRe[half] /= n;
+    mIm[half] = 0.0f;
+    for (size_t k = half + 1; k < n; k++)
+    {
+      mRe[k] = 0.0f;
+      mIm[k] = 0.0f;
+    }
+    FFT(mRe, mIm, n, false);
+  }
+  else
+  {
+    for (size_t k = 0; k < n; k++)
+    {
+      const float mag = expf(mRe[k]);
+      const float phase = mIm[k];
+      mRe[k] = mag * cosf(phase);
+      mIm[k] = mag * sinf(phase);
+    }
+    FFT(mRe, mIm, n, true);
+
+    for (size_t i = 0; i < mLength; i++)
+      out[i] = mRe[i] / n;
+  }
+}
+
+void IrMorph::_LogMagnitude(const float* kernel, float* logMag)
+{
+  const size_t n = mFftSize;
+  for (size_t i = 0; i < n; i++)
+  {
+    mRe[i] = i < mLength ? kernel[i] : 0.0f;
+    mIm[i] = 0.0f;
+  }
+  FFT(mRe, mIm, n, false);
+  for (size_t k = 0; k <= n / 2; k++)
+  {
+    const float mag = sqrtf(mRe[k] * mRe[k] + mIm[k] * mIm[k]);
+    logMag[k] = logf(std::max(mag, 1e-6f));  // -120 dB floor
+  }
+}
@@ -0,0 +1,101 @@
+//
+//  IrMorph.h
+//
+// Continuous blend between two cabinet IRs at the cost of one convolution.
+//   Both IRs are aligned (main peak) and level matched once in Prepare(); the
+//   blended kernel is computed at control rate and handed to
+//   ImpulseResponse::SetKernel(), so the audio path only ever runs one FIR.
+//
+//   MORPH_TIME     weighted sum of the aligned kernels, cheap, fine for IRs
+//                  with similar phase (same mic, different cab)
+//   MORPH_SPECTRAL log-magnitude interpolation with a minimum phase
+//                  reconstruction, for IRs whose phase differs (different mics
+//                  or positions), costs three FFTs per blend
+//
+//   BeginPrepare()/StepPrepare() and BeginBlend()/StepBlend() do the same as
+//   Prepare() and Blend() one FFT at a time, for the control loop's scheduler
+//   (scheduler.h).
+//
+//   Stereo/dual-mic pairs: the right IRs get the same alignment shift and level
+//   match as the left ones, so the timing and balance between the mics is kept.
+
+#pragma once
+
+#include <vector>
+#include "ImpulseResponse.h"
+
+#define IR_MORPH_FFT_SIZE (2 * IR_MAX_LENGTH)
+
+class IrMorph
+{
+public:
+  enum Mode
+  {
+    MORPH_TIME,
+    MORPH_SPECTRAL
+  };
+
+  // Control context only
+  void Prepare(const std::vector<float>& irA, const std::vector<float>& irB);
+  // Empty right IRs mean mono; if only one cab is a pair, the other uses its
+  // mono IR on both sides.
+  void Prepare(const std::vector<float>& irA, const std::vector<float>& irB,
+               const std::vector<float>& irARight, const std::vector<float>& irBRight);
+  // Prepare() in steps: StepPrepare() until it returns true. The IRs are read
+  // as it goes and must stay valid until then; a blend in between starts over.
+  void BeginPrepare(const std::vector<float>& irA, const std::vector<float>& irB,
+                    const std::vector<float>& irARight, const std::vector<float>& irBRight);
+  bool StepPrepare();
+  // 0..1, 1 once StepPrepare() has returned true
+  float PrepareProgress() const;
+  // amount: 0 = A, 1 = B. Writes Length() samples to out (and outRight if IsStereo()).
+  void Blend(float amount, Mode mode, float* out, float* outRight = nullptr);
+  // Blend() in steps: StepBlend() until it returns true. The buffers are
+  // written as it goes; Prepare() in between means starting over.
+  void BeginBlend(float amount, Mode mode, float* out, float* outRight = nullptr);
+  bool StepBlend();
+  // 0..1, 1 once StepBlend() has returned true
+  float BlendProgress() const;
+
+  // Length of the aligned kernels
+  size_t Length() const { return mLength; }
+  bool IsStereo() const { return mStereo; }
+  // Aligned, level matched kernel A (what Blend() returns at 0)
+  const float* KernelA() const { return mA; }
+  const float* KernelARight() const { return mStereo ? mAR : nullptr; }
+
+private:
+  void _Align();
+  void _LogMagnitude(const float* kernel, float* logMag);
+  void _SpectralStage(int stage, const float* logMagA, const float* logMagB, float* out);
+
+  float mA[IR_MAX_LENGTH];
+  float mB[IR_MAX_LENGTH];
+  float mAR[IR_MAX_LENGTH];
+  float mBR[IR_MAX_LENGTH];
+  size_t mLength = 0;
+  size_t mFftSize = 0;
+  bool mStereo = false;
+
+  float mLogMagA[IR_MORPH_FFT_SIZE / 2 + 1];
+  float mLogMagB[IR_MORPH_FFT_SIZE / 2 + 1];
+  float mLogMagAR[IR_MORPH_FFT_SIZE / 2 + 1];
+  float mLogMagBR[IR_MORPH_FFT_SIZE / 2 + 1];
+  // Prepare in progress
+  const std::vector<float>* mIrA = nullptr;
+  const std::vector<float>* mIrB = nullptr;
+  const std::vector<float>* mIrARight = nullptr;
+  const std::vector<float>* mIrBRight = nullptr;
+  int mPrepareStep = 0;
+  int mPrepareSteps = 0;
+  // Blend in progress
+  float mAmount = 0.0f;
+  Mode mMode = MORPH_TIME;
+  float* mOut = nullptr;
+  float* mOutRight = nullptr;
+  int mStep = 0;
+  int mSteps = 0;
+
+  float mRe[IR_MORPH_FFT_SIZE];
+  float mIm[IR_MORPH_FFT_SIZE];
+};
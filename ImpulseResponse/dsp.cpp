@@ -37,7 +37,7 @@ void History::_RewindHistory()
 
 void History::_UpdateHistory(float inputs)
 {
-  if (mHistoryIndex + 1 >= mHistory.size())
+  if (mHistoryIndex + 1 >= mHistorySize)
     _RewindHistory();
 
   mHistory[mHistoryIndex] = inputs;
@@ -1,6 +1,12 @@
 #pragma once
 
-#include <vector>
+#include <cstddef>
+
+// Fixed history storage, so the buffer lives wherever the owning object is placed
+// (the IR is hot state and sits in DTCM on the Daisy, see altair.cpp)
+#ifndef HISTORY_MAX_SIZE
+#define HISTORY_MAX_SIZE 5120
+#endif
 
 // A class where a longer buffer of history is needed to correctly calculate
 // the DSP algorithm (e.g. algorithms involving convolution).
@@ -22,7 +28,9 @@ protected:
   void _UpdateHistory(float inputs);
 
   // The history array that's used for DSP calculations.
-  std::vector<float> mHistory;
+  float mHistory[HISTORY_MAX_SIZE];
+  // Used part of mHistory
+  size_t mHistorySize = 0;
   // How many samples previous are required.
   // Zero means that no history is required--only the current sample.
   size_t mHistoryRequired = 0;
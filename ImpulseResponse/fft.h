@@ -0,0 +1,48 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+
+// In-place iterative radix-2 complex FFT over separate real/imaginary arrays.
+// n must be a power of two. The inverse is not scaled, divide by n.
+// Control-rate helper (IR preparation, analysis), not meant for the audio path.
+inline void FFT(float* re, float* im, size_t n, bool inverse)
+{
+  // Bit reversal
+  for (size_t i = 1, j = 0; i < n; i++)
+  {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if (i < j)
+    {
+      float t = re[i]; re[i] = re[j]; re[j] = t;
+      t = im[i]; im[i] = im[j]; im[j] = t;
+    }
+  }
+
+  for (size_t len = 2; len <= n; len <<= 1)
+  {
+    const double angle = (inverse ? 2.0 : -2.0) * M_PI / len;
+    const float wRe = (float)cos(angle);
+    const float wIm = (float)sin(angle);
+    for (size_t i = 0; i < n; i += len)
+    {
+      float curRe = 1.0f, curIm = 0.0f;
+      for (size_t k = 0; k < len / 2; k++)
+      {
+        const size_t a = i + k, b = i + k + len / 2;
+        const float tRe = re[b] * curRe - im[b] * curIm;
+        const float tIm = re[b] * curIm + im[b] * curRe;
+        re[b] = re[a] - tRe;
+        im[b] = im[a] - tIm;
+        re[a] += tRe;
+        im[a] += tIm;
+        const float nextRe = curRe * wRe - curIm * wIm;
+        curIm = curRe * wIm + curIm * wRe;
+        curRe = nextRe;
+      }
+    }
+  }
+}
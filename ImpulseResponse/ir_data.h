@@ -35,4 +35,9 @@ std::vector<float> ir_data3 = { 0.52926904,0.9913671,0.7762714,0.30122554,0.0276
                           };
 
 std::vector<std::vector<float>> ir_collection = {  ir_data1, ir_data2, ir_data3
-                                                 };
\ No newline at end of file
+                                                 };
+
+// Right channel of stereo/dual-mic pairs, same order as ir_collection.
+// An empty entry means the cab is mono and both sides use ir_collection.
+std::vector<std::vector<float>> ir_collection_right = {  {}, {}, {}
+                                                       };
@@ -0,0 +1,60 @@
+// Eco cab data, generated by host/ir_fit from ir_data.h (`make ir-fit`), don't edit.
+// Biquads as { b0, b1, b2, a1, a2 }, same order as ir_collection.
+// Error vs the 1/6 octave smoothed IR response, 50 Hz..10 kHz:
+//   IR 1: 400 taps -> 12 biquads, 0.86 dB RMS, 3.34 dB max
+//   IR 2: 400 taps -> 12 biquads, 0.53 dB RMS, 2.27 dB max
+//   IR 3: 400 taps -> 12 biquads, 1.41 dB RMS, 4.44 dB max
+
+#pragma once
+
+#include <vector>
+#include "EcoCab.h"
+
+const EcoCabData ir_eco_data1 = { 12, {
+    { 24.4580304, -48.9160608, 24.4580304, -1.97449825, 0.975006469 },
+    { 0.00257875454, 0.00515750908, 0.00257875454, -1.67901975, 0.689334773 },
+    { 2.86937097, -1.30016168, -1.12115621, -1.30016168, 0.748214757 },
+    { 0.576901701, -0.544628337, 0.515364041, -0.544628337, 0.0922657425 },
+    { 0.893854629, -1.6756612, 0.78553305, -1.6756612, 0.67938768 },
+    { 1.01187651, -1.8536359, 0.927664089, -1.8536359, 0.9395406 },
+    { 0.990954902, -1.88376424, 0.943998654, -1.88376424, 0.934953555 },
+    { 1.00339683, -1.97227854, 0.977149165, -1.97227854, 0.980545999 },
+    { 0.996371448, -1.97119976, 0.98067101, -1.97119976, 0.977042458 },
+    { 1.00026278, -1.99955078, 0.999294853, -1.99955078, 0.999557635 },
+    { 1.02214418, -0.658041251, 0.788046466, -0.658041251, 0.810190646 },
+    { 1.00185577, -1.97307275, 0.978585082, -1.97307275, 0.980440854 },
+} };
+
+const EcoCabData ir_eco_data2 = { 12, {
+    { 2.85402358, -5.70804715, 2.85402358, -1.98879496, 0.988806295 },
+    { 0.0861817075, 0.172363415, 0.0861817075, -1.37780539, 0.722532221 },
+    { 1.02013526, -1.98536276, 0.965470811, -1.98536276, 0.985606067 },
+    { 0.457506986, -0.155837382, 0.346354213, -0.155837382, -0.196138801 },
+    { 1.06351123, -1.79207877, 0.830166929, -1.79207877, 0.893678159 },
+    { 1.00891134, -1.96275079, 0.963979071, -1.96275079, 0.972890406 },
+    { 1.35818071, 0.195298347, 0.531382856, 0.195298347, 0.889563568 },
+    { 0.997481478, -1.98729464, 0.990640023, -1.98729464, 0.988121501 },
+    { 1.03413925, -0.73634616, 0.85016789, -0.73634616, 0.884307143 },
+    { 0.995155765, -1.91759701, 0.970772283, -1.91759701, 0.965928048 },
+    { 0.99475212, -1.81297342, 0.968207463, -1.81297342, 0.962959583 },
+    { 1.01174262, -1.18363959, 0.82417912, -1.18363959, 0.835921738 },
+} };
+
+const EcoCabData ir_eco_data3 = { 12, {
+    { 7.23534474, -14.4706895, 7.23534474, -1.92904671, 0.929510298 },
+    { 0.073517308, 0.147034616, 0.073517308, -1.12859003, 0.422659258 },
+    { 0.916152741, -1.73656925, 0.85521069, -1.73656925, 0.771363431 },
+    { 0.929054649, -1.81114081, 0.886983439, -1.81114081, 0.816038088 },
+    { 0.867141705, -1.15608431, 0.772090233, -1.15608431, 0.639231938 },
+    { 1.01217688, -1.99256754, 0.980618412, -1.99256754, 0.992795296 },
+    { 1.00284889, -1.99960799, 0.996767397, -1.99960799, 0.999616284 },
+    { 1.0130058, -1.84761617, 0.925520215, -1.84761617, 0.938526013 },
+    { 0.985554099, -1.86357241, 0.938468109, -1.86357241, 0.924022208 },
+    { 1.00919363, -1.91344557, 0.94784061, -1.91344557, 0.957034242 },
+    { 0.998854271, -1.99077378, 0.992744436, -1.99077378, 0.991598707 },
+    { 0.97393749, -1.04328488, 0.816290587, -1.04328488, 0.790228077 },
+} };
+
+std::vector<EcoCabData> ir_eco_collection = { ir_eco_data1, ir_eco_data2, ir_eco_data3 };
+// Empty (0 sections) where the cab is mono
+std::vector<EcoCabData> ir_eco_collection_right = { {}, {}, {} };
@@ -1,13 +1,7 @@
 
 
-struct modelData {
-  std::vector<std::vector<float>> rec_weight_ih_l0; 
-  std::vector<std::vector<float>> rec_weight_hh_l0;  
-  std::vector<std::vector<float>> lin_weight;
-  std::vector<float> lin_bias;
-  std::vector<std::vector<float>> rec_bias;
-  float levelAdjust;
-};
+#include "model_registry.h"
+#include "wh_lite_data.h"     // lite models distilled from the entries below (`make wh-distill`)
 
 // ADD YOUR MODEL IDENTIFIER HERE ////////////////////////////////// < -------------------
 modelData Model1; 
@@ -30,6 +24,18 @@ void setupWeights() {
 
 // COPY AND PASTE YOUR MODEL WEIGHTS BELOW (After converting .json to .h file) ////////////////////////////////// < -------------------
 //   ADD AND REMOVE MODELS AS DESIRED (CAN HOLD AROUND 15-16 MODELS IN FLASH MEMORY)
+//
+//   Conditioned models (input_size 2 or 3) replace a whole bank of gain snapshots with one
+//   set of weights. Paste them the same way and set inputSize to the model's input_size:
+//     ModelN.rec_weight_ih_l0 = {{ ...audio row... }, { ...knob 1 row... }};   // input_size : 2
+//     ModelN.inputSize = 2;
+//
+//   Entries default to GRU 9. Other architectures from model_registry.h are declared per entry:
+//     ModelN.arch = ARCH_GRU12;   // or ARCH_GRU8, ARCH_LSTM8
+//
+//   Snapshot entries can run a lite model distilled from them (see the ESR list in wh_lite_data.h):
+//     ModelN.lite = &ModelNLite;
+//     ModelN.run = RUN_AUTO;      // lite only when the GRU doesn't fit the budget, RUN_LITE always
 
 
   //========================================================================
@@ -64,6 +70,8 @@ bias_fl : True
   Model1.rec_bias = {{1.1973379850387573, -0.44106385111808777, -0.13644300401210785, -0.3490041494369507, 1.3261643648147583, -0.380979061126709, 0.19212310016155243, -0.24578654766082764, 1.454893708229065, 0.34279128909111023, 0.30362242460250854, 0.3117355704307556, 0.5360283255577087, -0.018552329391241074, 0.3106920123100281, 0.0398116409778595, -0.0714878961443901, 0.07045018672943115, -0.3137598931789398, 0.06450533866882324, 0.0797731876373291, 0.0582866370677948, -0.14376848936080933, 0.27043846249580383, -0.21152986586093903, -0.28778964281082153, 0.2651936709880829}, 
                     { 1.1973379850387573, -0.44106385111808777, -0.13644300401210785, -0.3490041494369507, 1.3261642456054688, -0.380979061126709, 0.19212310016155243, -0.24578654766082764, 1.454893708229065, 0.3406675457954407, 0.30381959676742554, 0.311753511428833, 0.536015510559082, -0.017991140484809875, 0.3106525242328644, 0.03981161117553711, -0.07112261652946472, 0.07591364532709122, 0.4408111870288849, 0.13189712166786194, 0.2187042236328125, -0.040134504437446594, 0.08460792899131775, -0.19480018317699432, -0.1755005568265915, 0.04271353408694267, -0.5428429841995239}}; 
   Model1.levelAdjust = 0.9;
+  Model1.lite = &Model1Lite;
+  Model1.run = RUN_AUTO;
 
   //========================================================================
 //../newNeuralSeedModel matchless_gru9_p02_shift51   keep (sounds better than the ac30 model)
@@ -131,6 +139,8 @@ bias_fl : True
   Model3.rec_bias = {{-0.28041866421699524, 1.2571043968200684, 0.6403751373291016, 0.08690151572227478, 1.4934308528900146, -0.35028815269470215, -0.49143001437187195, -0.4895656108856201, 1.1014631986618042, 0.4520479738712311, -0.022474439814686775, -0.048601340502500534, 0.366519957780838, 0.3722822368144989, 0.2166307419538498, 0.5753155946731567, 0.15795785188674927, 0.36920756101608276, -0.8323541283607483, -0.03967277333140373, -0.1421913504600525, 0.18015331029891968, -0.2311353236436844, 0.4627038240432739, -0.18875837326049805, -0.40674322843551636, 0.16267065703868866}, 
                     { -0.28041866421699524, 1.2571043968200684, 0.6403751373291016, 0.08690151572227478, 1.4934287071228027, -0.35028815269470215, -0.49143001437187195, -0.4895656108856201, 1.1014631986618042, 0.4475357234477997, -0.021434111520648003, -0.04855117201805115, 0.3662669360637665, 0.3732965588569641, 0.21644414961338043, 0.5753154754638672, 0.15866373479366302, 0.37739455699920654, -0.13255757093429565, -0.004366916138678789, -0.009892309084534645, 0.05774591863155365, 0.024283472448587418, 0.0388004370033741, -0.1363939493894577, -0.03807279095053673, -0.8816646337509155}}; 
   Model3.levelAdjust = 0.6;
+  Model3.lite = &Model3Lite;
+  Model3.run = RUN_AUTO;
 //========================================================================
 //../newNeuralSeedModel messa iic eq original p0128 shift 183 instead of 182  lowest noise, sounds good
 /*
@@ -230,6 +240,8 @@ bias_fl : True
   Model6.rec_bias = {{1.4791090488433838, 0.8872252106666565, 1.255505084991455, -0.6273059844970703, 2.0530476570129395, -0.8202617764472961, -0.6621493101119995, -0.2523471713066101, -0.0486859567463398, 0.15896804630756378, 0.14054542779922485, 0.10158023238182068, 0.6378490924835205, 0.16620376706123352, 0.3358059227466583, 0.22175993025302887, 0.23002469539642334, 0.4394044876098633, -0.23089683055877686, 0.027949901297688484, 0.007241227198392153, 0.015315423719584942, -0.04764167219400406, -0.10548243671655655, -0.11819690465927124, 0.08399385958909988, 0.3320634663105011}, 
                     { 1.4791090488433838, 0.8872252106666565, 1.255505084991455, -0.6273059844970703, 2.0530476570129395, -0.8202617764472961, -0.6621493101119995, -0.2523471713066101, -0.0486859567463398, 0.15723247826099396, 0.1405564695596695, 0.10158234089612961, 0.6378490924835205, 0.16658557951450348, 0.3358058035373688, 0.22175993025302887, 0.23002585768699646, 0.4395991861820221, 0.5436006784439087, -0.1353028416633606, 0.10029082000255585, 0.18212758004665375, 0.10946966707706451, 0.13357312977313995, 0.030321570113301277, -0.07347753643989563, -0.41494783759117126}}; 
   Model6.levelAdjust = 0.8;
+  Model6.lite = &Model6Lite;
+  Model6.run = RUN_AUTO;
 
   //========================================================================
 //../newNeuralSeedModel 5150_g5_gru9_p005_shift26
@@ -263,6 +275,8 @@ bias_fl : True
   Model7.rec_bias = {{-0.6570056676864624, -0.7625259757041931, -0.4935401380062103, 0.3882617950439453, 1.6678688526153564, 1.1328665018081665, 0.7226774096488953, -0.6539076566696167, 1.1644433736801147, 0.4385550320148468, 0.7962636947631836, 0.10724996030330658, 0.36334332823753357, 0.2530021369457245, 0.17276468873023987, 0.22074736654758453, 0.5745679140090942, 0.11506269872188568, -0.12087058275938034, -0.22438204288482666, -0.12205783277750015, -0.3330017924308777, 0.12413868308067322, -0.07059116661548615, 0.06413894891738892, -0.21534445881843567, 0.1563182920217514}, 
                     { -0.6570056676864624, -0.7625259757041931, -0.4935401380062103, 0.3882596790790558, 1.672628402709961, 1.1337413787841797, 0.7226774096488953, -0.6539076566696167, 1.1628081798553467, 0.4378686547279358, 0.7965229153633118, 0.09567991644144058, 0.36506515741348267, 0.2470959722995758, 0.13386721909046173, 0.22055870294570923, 0.574568510055542, 0.05572935566306114, -0.1475081890821457, 0.05165950208902359, -0.1899762749671936, 0.09854485094547272, -0.2138112634420395, 0.10794822871685028, -0.09042128175497055, 0.1349363476037979, 0.09115724265575409}}; 
   Model7.levelAdjust = 0.6;
+  Model7.lite = &Model7Lite;
+  Model7.run = RUN_AUTO;
 //========================================================================
 //../newNeuralSeedModel klon gain 80% tone 100% out 50% Ge p0042
 /*
@@ -21,14 +21,24 @@
 #include "hothouse.h"
 
 #include <RTNeural/RTNeural.h>  // NOTE: Need to use older version of RTNeural, same as GuitarML/Seed
+#include "model_registry.h"
 // Model Weights (edit this file to add model weights trained with Colab script)
-//    The models must be GRU (gated recurrent unit) with hidden size = 9, snapshot models (not condidtioned on a parameter)
+//    Each model declares its architecture (GRU 8/9/12 or LSTM 8, see model_registry.h) and is either
+//    a snapshot model or conditioned on 1-2 knob parameters (input size 2-3). Snapshots can
+//    carry a distilled lite model (wh_lite_data.h, `make wh-distill`) and declare whether they
+//    run it (RUN_LITE), the recurrent model (RUN_FULL), or whichever fits (RUN_AUTO)
 #include "all_model_data_gru9_4count.h"
 
 #include "ImpulseResponse/ImpulseResponse.h"
+#include "ImpulseResponse/IrMorph.h"
 #include "ImpulseResponse/ir_data.h"
+#include "ImpulseResponse/ir_eco_data.h"
 
 #include "lite_reverb.h"
+#include "altair_engine.h"
+#include "tuner.h"
+#include "load_governor.h"
+#include "scheduler.h"
 
 
 using clevelandmusicco::Hothouse;
@@ -36,186 +46,404 @@ using daisy::AudioHandle;
 using daisy::Led;
 using daisy::SaiHandle;
 using daisy::Parameter;
-using daisysp::Tone;
-using daisysp::ATone;
-using daisysp::Balance;
+using daisy::System;
 
 Hothouse hw;
 
-Parameter Gain, Level, Mix, filter, parm_time, parm_freq;
-
-LiteReverb DSY_SDRAM_BSS reverb;
-
-
-bool rn_model_enabled = true;
-bool ir_enabled = true;
+Parameter Gain, Level, Mix, filter, parm_freq;
+
+// KNOB 5 is the IR blend, except with a 3-input conditioned model loaded: then it
+//   is the model's second parameter (cond[1]) and the blend stays where it was,
+//   the same way KNOB 1 stops being input gain for conditioned models.
+//   The reverb's room size is fixed, KNOB 6 sets its decay.
+#define REVERB_ROOM_SIZE 1.0f
+bool knob5_cond = false;        // the loaded model reads KNOB 5
+
+// Memory placement
+//   Hot: everything the callback touches per sample (model weights and hidden state,
+//        IR kernel and history, filter and delay-line heads) is in the engine and
+//        its weights storage, which live in DTCM.
+//   Cold/large: reverb, delay and looper buffers in SDRAM, model and IR assets in flash/heap,
+//        only read when switching.
+//   `make memmap` prints where everything ended up and flags hot objects in slow memory.
+float DSY_SDRAM_BSS reverb_mem[REVERB_MEM_SIZE];
+float DSY_SDRAM_BSS delay_mem[DELAY_MEM_SIZE];
+float DSY_SDRAM_BSS looper_mem[LOOPER_MEM_SIZE];
+
+// Signal chain, see altair_engine.h
+AltairEngine DSY_DTCMRAM engine;
+EngineWeights DSY_DTCMRAM engine_weights;
 
 volatile bool g_toggle_bypass_req = false;
 
+// Delay: switch 3 down = off, middle = triplet second tap, up = dotted eighth.
+//   While it's on, FOOTSWITCH 1 taps the tempo instead of switching the model bank.
+TapTempo tap_tempo;
+
+// Tuner, active while bypassed: the callback feeds a decimated copy of the input
+//   through the ring, the main loop does the pitch detection and drives the LEDs
+//   (LED 1 flat, LED 2 sharp, both in tune). FOOTSWITCH 1 mutes the output.
+#define TUNER_NEAR_CENTS 15.0f      // closer than this the LED blinks
+TunerRing       tuner_ring;
+TunerFeed       tuner_feed;
+Tuner           tuner;
+bool            tuner_active = false;
+volatile bool   g_tuner_mute = false;
+
+// Load governor: watches the whole callback's time and steps the chain's quality
+//   down before the deadline is missed, back up when there's room again
+//   (see load_governor.h). Transitions are logged over USB serial.
+CycleMeter      callback_meter;
+LoadGovernor    governor;
+GovernorLog     governor_log;
+
 // Bypass vars
 Led led_bypass;
-bool bypass = true;
-
-float dryMix, wetMix;
+Led led_warn;       // requested model doesn't fit the callback budget, dim: governor stepped down,
+                    // in looper mode the looper state
 
 
 float           mix_effects;
 
-float vfilter;
-Tone tone;       // Low Pass
-ATone toneHP;    // High Pass
-Balance bal;     // Balance for volume correction in filtering
-
 // Impulse Response
-ImpulseResponse mIR;
 int   m_currentIRindex = 0;
 
+// Control loop (see scheduler.h): periodic tasks for the controls, the display
+//   and the logs; deferred jobs, run in slices between them, for anything that
+//   would hold them up.
+#define CONTROL_PERIOD_US 10000
+#define STATS_PERIOD_US 100000
+#define JOB_SLICE_US 2000       // job work per pass through the loop
+Scheduler       scheduler;
+
+// IR blend: KNOB 5 morphs from the IR selected by switch 1 towards the next one
+//   (unless a 3-input model has it, see knob5_cond).
+//   The blended kernel is computed by a job in the control loop, one FFT per
+//   step, and swapped into the engine's convolver, so only one convolution runs
+//   in the audio path. Use MORPH_SPECTRAL for IR pairs with different phase
+//   (different mics).
+IrMorph         ir_morph;
+IrMorph::Mode   ir_morph_mode = IrMorph::MORPH_TIME;
+float           ir_blend_kernel[IR_MAX_LENGTH];
+float           ir_blend_kernel_right[IR_MAX_LENGTH];
+float           ir_blend = 0.0f;
+
+class IrBlendJob : public SlicedJob {
+  public:
+    void Begin() override {
+        ir_morph.BeginBlend(ir_blend, ir_morph_mode, ir_blend_kernel, ir_blend_kernel_right);
+    }
+    bool Step() override {
+        return ir_morph.StepBlend();
+    }
+    bool Publish() override {
+        const float* right = ir_morph.IsStereo() ? ir_blend_kernel_right : nullptr;
+        return engine.SetIRKernel(ir_blend_kernel, right, ir_morph.Length());
+    }
+    float Progress() const override {
+        return ir_morph.BlendProgress();
+    }
+};
+IrBlendJob      ir_blend_job;
+
+// Eco cab: flip switch 1 away and straight back (within ECO_FLIP_MS) to swap the
+//   FIR cab for the biquad fit of the same IR (ir_eco_data.h, `make ir-fit`).
+//   An IR change waits until switch 1 has rested that long, so the flip never
+//   loads the other IR. No footswitch involved: FOOTSWITCH 1 keeps acting on
+//   press, and a long hold of it stays the bootloader's.
+#define ECO_FLIP_MS 300
+bool            eco_cab_pending = false;
+bool            sw1_moving = false;     // switch 1 left the loaded IR's position
+uint32_t        sw1_moved_at;
+
+// IR change (switch 1): aligning the new pair and taking its spectra is a few
+//   FFTs, so it's a job as well, one FFT per step. It hands over by queueing
+//   the blend, which publishes the kernel, and the eco cab of the same IR.
+class IrPrepareJob : public SlicedJob {
+  public:
+    void Begin() override {
+        int next = (m_currentIRindex + 1) % ir_collection.size();
+        ir_morph.BeginPrepare(ir_collection[m_currentIRindex], ir_collection[next],
+                              ir_collection_right[m_currentIRindex], ir_collection_right[next]);
+    }
+    bool Step() override {
+        return ir_morph.StepPrepare();
+    }
+    bool Publish() override {
+        eco_cab_pending = true;
+        return scheduler.Submit(&ir_blend_job);
+    }
+    float Progress() const override {
+        return ir_morph.PrepareProgress();
+    }
+};
+IrPrepareJob    ir_prepare_job;
+
+// Looper: hold FOOTSWITCH 2 to enter or leave looper mode (leaving stops the loop
+//   but keeps it). In looper mode FOOTSWITCH 1 taps record / play / overdub on
+//   press, FOOTSWITCH 2 stops, or clears once stopped; LED 1 shows the state.
+//   Bypass toggles on FOOTSWITCH 2's release, unless it was held.
+#define LOOPER_HOLD_MS 800.0f
+bool            looper_mode = false;
+bool            fs2_held = false;       // this press already toggled looper mode
 
 
 
-// Neural Network Model
-// Currently only using snapshot models, they tend to sound better and 
-//   we can use input level as gain.
 
-RTNeural::ModelT<float, 1, 1,
-                 RTNeural::GRULayerT<float, 1, 9>,
-                 RTNeural::DenseT<float, 9, 1>> model;
+#define COST_PROBE_SIZE 256
+#define LOAD_LIMIT 0.9f     // share of the callback period the whole chain may use
+
+// Model banks: switch 2 picks one of three models in the bank, FOOTSWITCH 1 steps
+//   through the banks. The last bank only holds models 7 and 8, its UP position
+//   is model 8 as well.
+#define MODEL_BANK_SIZE 3
 
-int             modelInSize;
 unsigned int    modelIndex;
-float           nnLevelAdjust;
 int             indexMod;
-int index_shift = 0;
+int index_shift = 0;       // first model of the bank
+bool model_refused = false;
+
+// Measured on the hardware at boot by measure_costs(), seconds of CPU per sample
+float archCost[ARCH_COUNT];
+float liteCost;     // lite model instead of archCost
+float fxCost;       // tone + delay + reverb
+float irCost;
+float ecoCost;      // eco cab instead of irCost
+float rsCost;       // 96 kHz I/O: half-band decimation + interpolation, per I/O sample
 // Notes: With default settings, GRU 10 is max size currently able to run on Daisy Seed
 //        - Parameterized 1-knob GRU 10 is max, GRU 8 with effects is max
 //        - Parameterized 2-knob/3-knob at GRU 8 is max
 //        - With multi effect (reverb, etc.) added GRU 9 is recommended to allow room for processing of other effects
+//        - If the chain still runs close to the deadline, the load governor trims the IR, then narrows the
+//             reverb, then crossfades the amp model out, and restores them when the load drops
+//        - model_fits() checks the measured cost of each architecture against the callback budget
+//             and refuses models that would not fit next to the active effects (LED 1 lights up).
+//             RUN_AUTO entries switch to their lite model instead.
 //        - These models should be trained using 48kHz audio data, since Daisy uses 48kHz by default.
 //             Models trained with other samplerates, or running Daisy at a different samplerate will sound different.
+//             With ALTAIR_IO_96K (see Makefile) the I/O runs at 96kHz and the chain stays at 48kHz
+//             between half-band filters, so the models still sound right.
 
 
+// Prepared by ir_prepare_job, the blend job publishes the new IR's kernel
+//   through SetIRKernel() and the audio side crossfades to it
 void setup_ir() {
-    mIR.Init(ir_collection[m_currentIRindex]);
+    scheduler.Submit(&ir_prepare_job);
 }
 
-void setup_model() {
-    auto& gru = (model).template get<0>();
-    auto& dense = (model).template get<1>();
-    modelInSize = 1;
-    gru.setWVals(model_collection[modelIndex].rec_weight_ih_l0);
-    gru.setUVals(model_collection[modelIndex].rec_weight_hh_l0);
-    gru.setBVals(model_collection[modelIndex].rec_bias);
-    dense.setWeights(model_collection[modelIndex].lin_weight);
-    dense.setBias(model_collection[modelIndex].lin_bias.data());
-    model.reset();
-
-    nnLevelAdjust = model_collection[modelIndex].levelAdjust;
+// Control loop: hand the current IR's eco cab to the engine
+void update_eco_cab() {
+    if (eco_cab_pending) {
+        eco_cab_pending = !engine.SetEcoCab(ir_eco_collection[m_currentIRindex],
+                                            &ir_eco_collection_right[m_currentIRindex]);
+    }
 }
 
-void AudioCallback(AudioHandle::InputBuffer in, AudioHandle::OutputBuffer out, size_t size) {
-    // float input_arr[1] = { 0.0 };    // Neural Net Input
-    float delay_out;
+// Control loop: follow KNOB 5 with the blended IR kernel
+void update_ir_blend() {
+    if (knob5_cond) {
+        return;
+    }
+    float b = hw.knobs[Hothouse::KNOB_5].Value();
+    if (fabsf(b - ir_blend) > 0.005f) {
+        ir_blend = b;
+        scheduler.Submit(&ir_blend_job);
+    }
+}
 
-    // hw.ProcessAllControls();
+// Whether a model_collection entry can run, and as its lite version or not. False if the
+//   weights don't match the declared architecture or the chain would not fit the callback.
+bool model_fits(const modelData& md, bool& lite) {
+    if (!ModelShapeValid(md)) {
+        return false;
+    }
+    float cab = engine.eco_cab_enabled ? ecoCost : irCost;
+    float rest = (fxCost + (engine.ir_enabled ? cab : 0.0f)) * engine.CoreSampleRate()
+                 + rsCost * hw.AudioSampleRate();
+    lite = md.run == RUN_LITE && LiteAvailable(md);
+    if (!lite && archCost[md.arch] * engine.CoreSampleRate() + rest > LOAD_LIMIT) {
+        if (md.run != RUN_AUTO || !LiteAvailable(md)) {
+            return false;
+        }
+        lite = true;
+    }
+    return !lite || liteCost * engine.CoreSampleRate() + rest <= LOAD_LIMIT;
+}
 
-    float vgain = Gain.Process();
-    float vmix = Mix.Process();
-    float vlevel = Level.Process();
-    float vfilter = filter.Process();
-    float reverb_time = parm_time.Process();
-    float reverb_freq = parm_freq.Process();
-
-    reverb.SetRoomSize(reverb_time);
-    reverb.SetDecay(reverb_freq);
-
-    // Mix and tone control
-    // Set Filter Controls
-    if (vfilter <= 0.5) {
-        float filter_value = (vfilter * 39800.0f) + 100.0f;
-        tone.SetFreq(filter_value);
-    } else {
-        float filter_value = (vfilter - 0.5) * 800.0f + 40.0f;
-        toneHP.SetFreq(filter_value);
+// Model change (switch 2): the budget check, then the load into the engine's idle
+//   slot. That's microseconds of copying, so one step, but as a job quick switch
+//   flips coalesce, and the load is retried while the engine is still taking the
+//   last one. A model that doesn't fit is refused and the current one stays.
+unsigned int    model_request;
+
+class ModelLoadJob : public SlicedJob {
+  public:
+    void Begin() override {
+        index = model_request;
+        checked = false;
+    }
+    bool Step() override {
+        fits = model_fits(model_collection[index], lite);
+        checked = true;
+        return true;
+    }
+    bool Publish() override {
+        if (fits && !engine.LoadModel(model_collection[index], lite)) {
+            return false;
+        }
+        model_refused = !fits;
+        if (fits) {
+            modelIndex = index;
+            knob5_cond = model_collection[index].inputSize > 2;
+        }
+        return true;
+    }
+    float Progress() const override {
+        return checked ? 1.0f : 0.0f;
     }
 
-    // Calculate mix parameters
-    //    A cheap mostly energy constant crossfade from SignalSmith Blog
-    //    https://signalsmith-audio.co.uk/writing/2021/cheap-energy-crossfade/
-    float x2 = 1.0 - vmix;
-    float A = vmix*x2;
-    float B = A * (1.0 + 1.4186 * A);
-    float C = B + vmix;
-    float D = B + x2;
+  private:
+    unsigned int index;
+    bool checked = false;
+    bool fits;
+    bool lite;
+};
+ModelLoadJob    model_load_job;
+
+// Time every architecture and the effect chain once at boot, before the audio starts
+void measure_costs() {
+    static AmpModel probe;
+    static float probe_in[COST_PROBE_SIZE];
+    static float probe_out[COST_PROBE_SIZE];
+    for (size_t i = 0; i < COST_PROBE_SIZE; i++) {
+        probe_in[i] = 0.5f * sinf(i * 0.05f);
+    }
 
-    wetMix = C * C;
-    dryMix = D * D;
+    for (int a = 0; a < ARCH_COUNT; a++) {
+        SelectArch(probe, (ModelArch)a);
+        uint32_t start = System::GetUs();
+        ProcessAmpModel(probe, probe_in, probe_out, COST_PROBE_SIZE);
+        archCost[a] = (System::GetUs() - start) * 1e-6f / COST_PROBE_SIZE;
+    }
 
+    // The lite model's cost doesn't depend on its data
+    static WhLiteData lite_probe_data;
+    static WhLite lite_probe;
+    lite_probe.Load(lite_probe_data);
+    uint32_t start = System::GetUs();
+    lite_probe.Process(probe_in, probe_out, COST_PROBE_SIZE);
+    liteCost = (System::GetUs() - start) * 1e-6f / COST_PROBE_SIZE;
+
+    start = System::GetUs();
+    probe_out[0] = engine.ProbeEffects(probe_in, COST_PROBE_SIZE);
+    fxCost = (System::GetUs() - start) * 1e-6f / COST_PROBE_SIZE;
+
+    start = System::GetUs();
+    probe_out[1] = engine.ProbeIR(probe_in, COST_PROBE_SIZE);
+    irCost = (System::GetUs() - start) * 1e-6f / COST_PROBE_SIZE;
+
+    start = System::GetUs();
+    probe_out[2] = engine.ProbeEcoCab(probe_in, COST_PROBE_SIZE);
+    ecoCost = (System::GetUs() - start) * 1e-6f / COST_PROBE_SIZE;
+
+    rsCost = 0.0f;
+    if (engine.IsMultirate()) {
+        start = System::GetUs();
+        probe_out[3] = engine.ProbeResampler(probe_in, COST_PROBE_SIZE);
+        rsCost = (System::GetUs() - start) * 1e-6f / COST_PROBE_SIZE;
+    }
 
+    // Start the real processing from clean state
+    engine.ResetEffects();
+}
 
+void AudioCallback(AudioHandle::InputBuffer in, AudioHandle::OutputBuffer out, size_t size) {
+    // hw.ProcessAllControls();
+    callback_meter.Start();
+
+    EngineControls ctl;
+    ctl.gain = Gain.Process();
+    ctl.mix = Mix.Process();
+    ctl.level = Level.Process();
+    ctl.filter = filter.Process();
+    ctl.reverb_time = REVERB_ROOM_SIZE;
+    ctl.reverb_decay = parm_freq.Process();
+    // Conditioned models read KNOB 1 (and KNOB 5) directly
+    ctl.cond[0] = hw.knobs[Hothouse::KNOB_1].Value();
+    ctl.cond[1] = hw.knobs[Hothouse::KNOB_5].Value();
 
     // react to main-loop request
     if (g_toggle_bypass_req) {
         g_toggle_bypass_req = false;
-        bypass = !bypass;
-        if (!bypass) {
-            model.reset();                  // clear GRU state
-            // hard reset IR tail to avoid immediate overload
-            // (if no .Reset() exists, re-init with the same IR)
-            // mIR.Reset(); // if available
-            mIR.Init(ir_collection[m_currentIRindex]);
-        }
+        engine.ToggleBypass();
     }
-    // Toggle bypass when FOOTSWITCH_2 is pressed
-    // if (hw.switches[Hothouse::FOOTSWITCH_2].RisingEdge()) {
-    //     bypass = !bypass;
-    //     if (!bypass) {
-    //         model.reset();
-    //     }
-    // }
-
-    for (size_t i = 0; i < size; ++i) {
-        if (bypass) {
-            // Copy left input to both outputs (mono-to-dual-mono)
-            out[0][i] = out[1][i] = in[0][i];
-            continue;
-        }
 
-        float x = in[0][i] * vgain;
-        // Neural
-        float amp_out = rn_model_enabled ? ((model.forward(&x) + x)*nnLevelAdjust) : x;
-
-        // Guardrails to stop NaNs/denormals from breaking the audio thread
-        // if (!isfinite(amp_out)) amp_out = 0.0f;
+    bool bypassed = engine.IsBypassed();
+    if (bypassed) {
+        tuner_feed.Process(in[0], size);
+    }
 
+    engine.Process(in[0], out[0], out[1], size, ctl);
 
+    if (bypassed && g_tuner_mute) {
+        for (size_t i = 0; i < size; i++) {
+            out[0][i] = out[1][i] = 0.0f;
+        }
+    }
 
-        // Process Tone
-        float filter_in =  amp_out;
-        float filter_out;
-        float balanced_out;
-        
-        if (vfilter <= 0.5) {
-            filter_out = tone.Process(filter_in);
-            balanced_out = bal.Process(filter_out, filter_in);
-        } else {
-            filter_out = toneHP.Process(filter_in);
-            balanced_out = bal.Process(filter_out, filter_in);
+    // Judge this block, adjust the next
+    callback_meter.Stop();
+    if (!bypassed) {
+        const float amp_out_load = engine.AmpOutLoad(size, hw.AudioSampleRate());
+        if (amp_out_load >= 0.0f) {
+            governor.Remeasure(QUALITY_AMP_BYPASS, amp_out_load);
         }
+        engine.SetQuality(governor.Update(callback_meter.LastLoad(size, hw.AudioSampleRate())));
+    }
+}
 
+// Main loop: print what the governor did
+void log_governor() {
+    GovernorEvent e;
+    while (governor_log.Pop(e)) {
+        hw.seed.PrintLine("governor: %s -> %s (load %d%%, block %u)", qualityName[e.from], qualityName[e.to],
+                          (int)(e.load * 100.0f), (unsigned)e.block);
+    }
+}
 
-        delay_out = reverb.Process(balanced_out);
+// Looper state on LED 1: off empty, on recording, blinking overdubbing, half
+//   playing, dim stopped
+float looper_led() {
+    switch (engine.LooperState()) {
+    case Looper::RECORDING:
+        return 1.0f;
+    case Looper::OVERDUBBING:
+        return (System::GetNow() / 125) & 1 ? 1.0f : 0.0f;
+    case Looper::PLAYING:
+        return 0.5f;
+    case Looper::STOPPED:
+        return 0.1f;
+    default:
+        return 0.0f;
+    }
+}
 
-        // IR
-        float y;
-        if (ir_enabled) {
-            y = mIR.Process(balanced_out * dryMix + delay_out * wetMix) * 0.2;
+// Tuner display on the two LEDs
+void show_tuner() {
+    float flat = 0.0f, sharp = 0.0f;
+    if (tuner.InTune()) {
+        flat = sharp = 1.0f;
+    } else if (tuner.Valid()) {
+        bool blink = (System::GetNow() / 125) & 1;
+        float on = fabsf(tuner.Cents()) > TUNER_NEAR_CENTS || blink ? 1.0f : 0.0f;
+        if (tuner.Cents() < 0.0f) {
+            flat = on;
         } else {
-            y = balanced_out * dryMix + delay_out * wetMix;
+            sharp = on;
         }
-
-        out[0][i] = y * vlevel;
-        out[1][i] = y * vlevel;
     }
+    led_warn.Set(flat);
+    led_bypass.Set(sharp);
 }
 
 int sw_1_value = 0;
@@ -266,95 +494,170 @@ int get_sw_3() {
     }
 }
 
+// Periodic: footswitches, toggle switches and knobs
+void control_task() {
+    hw.ProcessAllControls();
+
+    if (hw.switches[Hothouse::FOOTSWITCH_2].RisingEdge()) {
+        fs2_held = false;
+    }
+    if (hw.switches[Hothouse::FOOTSWITCH_2].Pressed() && !fs2_held &&
+        hw.switches[Hothouse::FOOTSWITCH_2].TimeHeldMs() >= LOOPER_HOLD_MS) {
+        fs2_held = true;
+        looper_mode = !looper_mode;
+        if (looper_mode && engine.IsBypassed()) {
+            g_toggle_bypass_req = true;     // the looper runs in the chain
+        } else if (!looper_mode && engine.LooperState() != Looper::STOPPED) {
+            engine.LooperRequest(Looper::STOP);
+        }
+    }
+    if (hw.switches[Hothouse::FOOTSWITCH_2].FallingEdge() && !fs2_held) {
+        if (looper_mode) {
+            engine.LooperRequest(Looper::STOP);
+        } else {
+            g_toggle_bypass_req = true; // signal audio thread
+        }
+    }
+
+    if (hw.switches[Hothouse::FOOTSWITCH_1].RisingEdge()) {
+        if (looper_mode) {
+            engine.LooperRequest(Looper::TAP);
+        } else if (engine.IsBypassed()) {
+            g_tuner_mute = !g_tuner_mute;
+        } else if (delay_sw_value != 0) {
+            if (tap_tempo.Tap(System::GetNow())) {
+                engine.SetDelayBeat(tap_tempo.BeatSeconds());
+            }
+        } else {
+            index_shift += MODEL_BANK_SIZE;
+            if (index_shift >= (int)model_collection.size()) {
+                index_shift = 0;
+            }
+        }
+    }
+
+    int sw1 = get_sw_1();
+    if (sw1 != sw_1_value) {
+        sw_1_value = sw1;
+        if (sw1_moving && sw1 == m_currentIRindex) {
+            sw1_moving = false;         // straight back: eco flip
+            engine.eco_cab_enabled = !engine.eco_cab_enabled;
+        } else {
+            sw1_moving = true;
+            sw1_moved_at = System::GetNow();
+        }
+    }
+    if (sw1_moving && System::GetNow() - sw1_moved_at >= ECO_FLIP_MS) {
+        sw1_moving = false;
+        if (sw1 != m_currentIRindex) {
+            m_currentIRindex = sw1;
+            setup_ir();
+        }
+    }
+    update_ir_blend();
+    update_eco_cab();
+
+    int m = get_sw_2() + index_shift;
+    if (m >= (int)model_collection.size()) {
+        m = model_collection.size() - 1;
+    }
+    if (m != m_number) {
+        m_number = m;
+        model_request = m;
+        scheduler.Submit(&model_load_job);
+    }
+
+    int d = get_sw_3();
+    if (d != delay_sw_value) {
+        if (d == 0) {
+            engine.SetDelay(false, 0.0f);
+        } else if (d == 1) {
+            engine.SetDelay(true, 0.6666667f); // triplett
+        } else if (d == 2) {
+            engine.SetDelay(true, 0.75f); // dotted eighth
+        }
+        delay_sw_value = d;
+    }
+
+    // Call System::ResetToBootloader() if FOOTSWITCH_1 is pressed for 2 seconds
+    hw.CheckResetToBootloader();
+}
+
+// Periodic: tuner while bypassed, LEDs
+void display_task() {
+    if (engine.IsBypassed()) {
+        if (!tuner_active) {
+            tuner.Reset();
+            tuner_active = true;
+        }
+        tuner.Update();
+        show_tuner();
+    } else {
+        tuner_active = false;
+        // Toggle effect bypass LED when footswitch is pressed
+        led_bypass.Set(1.0f);
+        if (looper_mode) {
+            led_warn.Set(looper_led());
+        } else {
+            led_warn.Set(model_refused ? 1.0f : engine.Quality() != QUALITY_FULL ? 0.2f : 0.0f);
+        }
+    }
+    led_bypass.Update();
+    led_warn.Update();
+}
+
 int main() {
     hw.Init();
+    hw.seed.StartLog(false);
+    scheduler.Init(System::GetUs, JOB_SLICE_US);
     hw.SetAudioBlockSize(256);  // Number of samples handled per callback
+#ifdef ALTAIR_IO_96K
+    hw.SetAudioSampleRate(SaiHandle::Config::SampleRate::SAI_96KHZ);
+#else
     hw.SetAudioSampleRate(SaiHandle::Config::SampleRate::SAI_48KHZ);
+#endif
     float samplerate =  hw.AudioSampleRate();
-    setup_ir();
+    engine.Init(samplerate, reverb_mem, delay_mem, looper_mem, &engine_weights);
+    tuner_feed.Init(samplerate, &tuner_ring);
+    tuner.Init(tuner_feed.Rate(), &tuner_ring);
+    ir_prepare_job.RunNow();    // queues the blend for the main loop
+    engine.LoadIR(ir_morph.KernelA(), ir_morph.KernelARight(), ir_morph.Length());  // until the blend lands
+    update_eco_cab();
     setupWeights();
 
-    // Initialize the correct model
-    modelIndex = 1;
-    nnLevelAdjust = 1.0;
-    indexMod = 0;
-    setup_model();
-
 
     // Initialize & set params for mixers 
     mix_effects = 0.5;
 
+    measure_costs();
+    governor.Init(GovernorConfig(), &governor_log);
 
-    tone.Init(samplerate);
-    toneHP.Init(samplerate);
-    bal.Init(samplerate);
-    vfilter = 0.5;
-
-    reverb.Init(samplerate);
+    // Initialize the correct model
+    modelIndex = 1;
+    indexMod = 0;
+    model_request = modelIndex;
+    model_load_job.RunNow();
 
 
     Gain.Init(hw.knobs[Hothouse::KNOB_1], 0.1f, 2.5f, Parameter::LINEAR);
     Mix.Init(hw.knobs[Hothouse::KNOB_2], 0.0f, 1.0f, Parameter::LINEAR);
     Level.Init(hw.knobs[Hothouse::KNOB_3], 0.0f, 1.0f, Parameter::LINEAR); // lower range for quieter level
     filter.Init(hw.knobs[Hothouse::KNOB_4], 0.0f, 1.0f, Parameter::CUBE);
-    parm_time.Init(hw.knobs[Hothouse::KNOB_5], 1.0f, 1.0f, Parameter::LINEAR);
     parm_freq.Init(hw.knobs[Hothouse::KNOB_6], 0.0f, 1.0f, Parameter::LINEAR);
 
     led_bypass.Init(hw.seed.GetPin(Hothouse::LED_2), false);
+    led_warn.Init(hw.seed.GetPin(Hothouse::LED_1), false);
 
     hw.StartAdc();
     hw.StartAudio(AudioCallback);
 
-    while (true) {
-        hw.DelayMs(10);
-        hw.ProcessAllControls();
-
-        if (hw.switches[Hothouse::FOOTSWITCH_2].RisingEdge()) {
-            g_toggle_bypass_req = true; // signal audio thread
-        }
+    scheduler.AddPeriodic("controls", control_task, CONTROL_PERIOD_US);
+    scheduler.AddPeriodic("display", display_task, CONTROL_PERIOD_US);
+    scheduler.AddPeriodic("stats", log_governor, STATS_PERIOD_US);
 
-        if (hw.switches[Hothouse::FOOTSWITCH_1].RisingEdge()) {
-            if (index_shift == 0) {
-                index_shift = 3;
-            } else {
-                index_shift = 0;
-            }
-        }
-
-        int sw1 = get_sw_1();
-        if (sw1 != sw_1_value) {
-            m_currentIRindex = sw1;
-            sw_1_value = sw1;
-            setup_ir();
-        }
-
-        int m = get_sw_2() + get_sw_3() + index_shift;
-        if (m != m_number) {
-            m_number = m;
-            modelIndex = m;
-            setup_model();
-        }
-
-        // int d = get_sw_3();
-        // if (d != delay_sw_value) {
-        //     if (d == 0) {
-        //         delay1.secondTapOn = false;
-        //     } else if (d == 1) {
-        //         delay1.secondTapOn = true;
-        //         delay1.del->set2ndTapFraction(0.6666667); // triplett
-        //     } else if (d == 2) {
-        //         delay1.secondTapOn = true;
-        //         delay1.del->set2ndTapFraction(0.75); // dotted eighth
-        //     }
-        //     delay_sw_value = d;
-        // }
-
-        // Toggle effect bypass LED when footswitch is pressed
-        led_bypass.Set(bypass ? 0.0f : 1.0f);
-        led_bypass.Update();
-
-        // Call System::ResetToBootloader() if FOOTSWITCH_1 is pressed for 2 seconds
-        hw.CheckResetToBootloader();
+    while (true) {
+        scheduler.Poll();
+        System::DelayUs(scheduler.IdleUs());
     }
     return 0;
 }
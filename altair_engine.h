@@ -0,0 +1,805 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Altair signal chain: amp model -> tone -> delay -> looper -> reverb -> IR
+//   Hardware independent, so the same chain runs in the pedal's AudioCallback
+//   and in the host tools. Everything the audio path touches is allocated up
+//   front; Process() and ToggleBypass() must never allocate or lock.
+//   All hot state (hidden state, IR history, tone and reverb heads) is stored
+//   inline, so placing the engine object places it; the weights (EngineWeights)
+//   and the large reverb, delay and looper buffers are external.
+//
+// Stereo back end (stereo_enabled)
+//   The amp stays mono. The stereo reverb's mid goes through the cab like the
+//   mono chain did; its side skips the cab, only darkened by a one-pole lowpass
+//   in place of the cab's top end, so the width costs no second convolution for
+//   mono IRs. L+R is the mono chain's output. Stereo/dual-mic IR pairs run both
+//   kernels in one pass over the shared history.
+//
+// Multi-rate
+//   The models are trained at 48 kHz and the IRs captured at 48 kHz, so the chain
+//   runs at CORE_SAMPLE_RATE. With 96 kHz I/O, Process() decimates the input with
+//   a half-band filter, runs the chain at 48 kHz and interpolates both outputs
+//   back. Tone, delay and reverb stay at the core rate too: they are cheaper
+//   there and sound the same. Bypass stays at the I/O rate, without the
+//   filters' latency.
+//
+// Eco cab (eco_cab_enabled)
+//   A biquad cascade fitted to the IR (ImpulseResponse/EcoCab.h) instead of the
+//   FIR, a few dozen MACs per sample instead of one per tap. Switching runs both
+//   for CAB_XFADE_SAMPLES and crossfades; the one switched to starts from clean
+//   state. Only the FIR follows the IR blend kernel.
+//
+// Lite amp models (LoadModel(md, true))
+//   A snapshot entry's distilled Wiener-Hammerstein model (wh_lite.h) runs in
+//   place of the recurrent one, with the same skip path and level adjust. Its
+//   filters and table are copied into EngineWeights, so they sit in DTCM too.
+//
+// Weights (EngineWeights)
+//   The amp models, lite tables and IR kernel buffers an engine loads itself
+//   live in storage the caller passes to Init(), like the delay lines, so the
+//   firmware places it in DTCM. A host engine that only runs shared weights
+//   (LoadModel(SharedAmpModel), LoadIR(ImpulseResponse)) is given none and
+//   carries just its state: recurrent and filter state, conditioning bias, IR
+//   history.
+//
+// Model changes
+//   The engine holds two amp slots. LoadModel() builds the new model, its lite
+//   version and its conditioning state in the slot the audio side isn't using,
+//   then marks it pending; the next block swaps slots before it touches the
+//   amp, the same handoff as the IR kernel. The audio side only ever reads the
+//   active slot, so a load never changes a model under the callback.
+
+// Looper (looper.h)
+//   Mono, after the delay: it records the amp, tone and delay, and plays back
+//   into the reverb and cab with the live signal, so both sit in the same room.
+//   It pauses in bypass and isn't touched by the quality levels; its cost is a
+//   couple of block copies to and from SDRAM.
+
+// Quality levels (SetQuality(), driven by the load governor)
+//   Each step trades sound for time and fades in, so stepping never clicks:
+//   the cab tail past IR_TRIM_LENGTH fades out, the reverb width narrows to the
+//   left lines over REVERB_WIDTH_FADE, and the amp model crossfades to its dry
+//   input over AMP_XFADE_SAMPLES. On the way back the amp starts from a clean
+//   state under the fade, and the right reverb lines read as empty until they've
+//   been rewritten. With the mono back end the reverb step saves nothing.
+//   While the amp is out it still runs on the first AMP_PROBE_SAMPLES of every
+//   block (output unused, the state is reset on the way back anyway), so the
+//   governor can tell from AmpOutLoad() whether bringing it back would fit.
+
+#pragma once
+
+#include <atomic>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+#include "model_registry.h"
+#include "ImpulseResponse/ImpulseResponse.h"
+#include "ImpulseResponse/EcoCab.h"
+#include "lite_reverb.h"
+#include "tone_stage.h"
+#include "tap_delay.h"
+#include "looper.h"
+#include "cycle_meter.h"
+#include "halfband.h"
+#include "load_governor.h"
+
+#define MAX_BLOCK_SIZE 256
+#define MAX_COND_PARAMS 2
+#define CORE_SAMPLE_RATE 48000.0f   // what the models are trained at
+
+#define STEREO_SIDE_GAIN    0.4f        // reverb width
+#define STEREO_SIDE_LP_FREQ 5000.0f     // stands in for the cab's top end on the side signal
+
+#define IR_TRIM_LENGTH 256              // cab taps kept under load, ~5 ms
+#define AMP_XFADE_SAMPLES 480.0f        // amp model in/out under load, 10 ms
+#define AMP_PROBE_SAMPLES 16            // amp model run per block while it's out
+#define REVERB_WIDTH_FADE 2400.0f       // stereo reverb to mono and back, 50 ms
+#define CAB_XFADE_SAMPLES 480.0f        // FIR <-> eco cab, 10 ms
+
+// Weights of an engine that loads its own: both amp slots' models and lite
+// tables, and the IR kernel buffers
+struct EngineWeights {
+    AmpModel models[2];
+    WhLiteData lite[2];
+    std::vector<std::vector<float>> recBias[2];     // model bias in SetRecBias() layout
+    IrKernelStore ir;
+};
+
+// Control values for one block, already scaled to their ranges
+struct EngineControls {
+    float gain;
+    float mix;
+    float level;
+    float filter;
+    float reverb_time;
+    float reverb_decay;
+    float cond[MAX_COND_PARAMS];    // raw 0..1 knob values for conditioned models
+};
+
+class AltairEngine {
+  public:
+    bool rn_model_enabled = true;
+    bool ir_enabled = true;
+    bool stereo_enabled = true;
+    bool eco_cab_enabled = false;
+
+    // sr: I/O rate. 96 kHz runs the chain at CORE_SAMPLE_RATE in between half-band
+    //   filters, any other rate runs it at sr.
+    // reverb_mem: REVERB_MEM_SIZE floats, delay_mem: DELAY_MEM_SIZE floats,
+    //   looper_mem: LOOPER_MEM_SIZE floats or null for no looper, passed in so
+    //   the buffers can live in SDRAM
+    // weights: storage for the models and IR the engine loads itself (DTCM), null
+    //   on a host engine that only runs shared ones
+    void Init(float io_sr, float* reverb_mem, float* delay_mem, float* looper_mem = nullptr,
+              EngineWeights* weights = nullptr) {
+        multirate = fabsf(io_sr - 2.0f * CORE_SAMPLE_RATE) < 1.0f;
+        float sr = multirate ? CORE_SAMPLE_RATE : io_sr;
+        sample_rate = sr;
+        if (multirate) {
+            halfband.Init();
+            decimator.Init(&halfband);
+            interpolatorL.Init(&halfband);
+            interpolatorR.Init(&halfband);
+        }
+        reverb_buffers = reverb_mem;
+        CycleMeter::Init();
+        tone.Init(sr);
+        delay.Init(sr, delay_mem);
+        looper.Init(sr, looper_mem, LOOPER_MEM_SIZE);
+        reverb.Init(sr, reverb_buffers);
+        sideLpCoef = 1.0f - expf(-2.0f * (float)M_PI * STEREO_SIDE_LP_FREQ / sr);
+        sideLp = 0.0f;
+        this->weights = weights;
+        mIR.SetStore(weights ? &weights->ir : nullptr);
+        for (int s = 0; s < 2; s++) {
+            amps[s].model = weights ? &weights->models[s] : nullptr;
+            amps[s].shared = nullptr;
+            amps[s].levelAdjust = 1.0f;
+            amps[s].inSize = 1;
+            amps[s].useLite = false;
+        }
+        ampActive = 0;
+        ampPending.store(false, std::memory_order_relaxed);
+        bypass = true;
+        quality = QUALITY_FULL;
+        ampGain = 1.0f;
+        ampProbeScale = 0.0f;
+        reverbWidth = 1.0f;
+        ecoMix = 0.0f;
+    }
+
+    // Control context only, allocates. lite: run the entry's lite model instead
+    //   of the recurrent one (snapshots with lite data only, see LiteAvailable()).
+    //   Built in the idle slot, the audio side switches to it at its next block.
+    //   False if the model doesn't fit, without weights storage, or while the
+    //   previous load is still pending (try again later).
+    bool LoadModel(const modelData& md, bool lite = false) {
+        if (!weights || !ModelShapeValid(md) || !CanLoad(md, lite)) {
+            return false;
+        }
+        const int s = ampActive ^ 1;
+        AmpSlot& a = BeginLoad(md, lite);
+        if (lite) {
+            weights->lite[s] = *md.lite;
+            a.lite.Load(weights->lite[s]);
+        } else {
+            LoadModelWeights(*a.model, md);
+            PrepareRecBias(md, weights->recBias[s]);
+            a.recBias = &weights->recBias[s];
+            a.condBias = *a.recBias;
+            ResetAmpModel(*a.model);
+        }
+        ampPending.store(true, std::memory_order_release);
+        return true;
+    }
+
+    // Host, control context: run weights prepared once (PrepareSharedAmp()) and
+    //   shared read-only between engine instances, the lite version from the
+    //   model table in place. Only the state is per engine. The weights must
+    //   outlive the engine; same handoff and refusals as above.
+    bool LoadModel(const SharedAmpModel& shared, bool lite = false) {
+        const modelData& md = *shared.md;
+        if (!CanLoad(md, lite)) {
+            return false;
+        }
+        AmpSlot& a = BeginLoad(md, lite);
+        a.shared = &shared;
+        if (lite) {
+            a.lite.Load(*md.lite);
+        } else {
+            a.recBias = &shared.bias;
+            if (md.inputSize > 1) {
+                a.condBias = shared.bias;
+            }
+            ResetAmpState(a.state);
+        }
+        ampPending.store(true, std::memory_order_release);
+        return true;
+    }
+
+    // The last loaded model runs as its lite version
+    bool LiteActive() const {
+        return amps[ampPending.load(std::memory_order_acquire) ? ampActive ^ 1 : ampActive].useLite;
+    }
+
+    // Setup only, before Process() runs: the convolver is rewritten in place.
+    //   Use SetIRKernel() once the audio is running. Needs weights storage.
+    void LoadIR(const std::vector<float>& irData) {
+        mIR.Init(irData);
+    }
+
+    void LoadIR(const float* irData, size_t length) {
+        mIR.Init(irData, length);
+    }
+
+    // Stereo/dual-mic pair, irRight may be null for a mono IR
+    void LoadIR(const float* irLeft, const float* irRight, size_t length) {
+        mIR.Init(irLeft, irRight, length);
+    }
+
+    // Host: convolve with a kernel owned by another ImpulseResponse, shared
+    // read-only between engine instances
+    void LoadIR(const ImpulseResponse& shared) {
+        mIR.Init(shared);
+    }
+
+    // Control context, no allocation: glitch-free kernel change, any length up to
+    // IR_MAX_LENGTH, mono or a pair (irRight null for mono). False while the
+    // previous change is still fading in.
+    bool SetIRKernel(const float* irData, size_t length) {
+        return mIR.SetKernel(irData, length);
+    }
+
+    bool SetIRKernel(const float* irLeft, const float* irRight, size_t length) {
+        return mIR.SetKernel(irLeft, irRight, length);
+    }
+
+    // Control context, no allocation: eco cab coefficients (right may be null or
+    // empty for a mono cab). False while the previous set is still pending.
+    bool SetEcoCab(const EcoCabData& left, const EcoCabData* right) {
+        return ecoCab.Set(left, right);
+    }
+
+    void ToggleBypass() {
+        bypass = !bypass;
+        if (!bypass) {
+            ResetAmp();             // clear GRU state
+            mIR.Reset();            // clear IR tail to avoid immediate overload
+            if (multirate) {
+                decimator.Reset();
+                interpolatorL.Reset();
+                interpolatorR.Reset();
+            }
+        }
+    }
+
+    // Rate the chain runs at (cost probes are per sample at this rate)
+    float CoreSampleRate() const {
+        return sample_rate;
+    }
+
+    bool IsMultirate() const {
+        return multirate;
+    }
+
+    bool IsBypassed() const {
+        return bypass;
+    }
+
+    // Audio context, before Process(): takes effect from the next block
+    void SetQuality(QualityLevel q) {
+        quality = q;
+    }
+
+    QualityLevel Quality() const {
+        return quality;
+    }
+
+    // Delay settings, control context
+    void SetDelay(bool on, float second_tap) {
+        delay.SetEnabled(on);
+        delay.SetSecondTap(second_tap);
+    }
+
+    void SetDelayBeat(float seconds) {
+        delay.SetBeat(seconds);
+    }
+
+    // Looper footswitch gestures, control context, taken at the next block
+    void LooperRequest(Looper::Action a) {
+        looper.Request(a);
+    }
+
+    Looper::State LooperState() const {
+        return looper.GetState();
+    }
+
+    const Looper::Traffic& LooperTraffic() const {
+        return looper.GetTraffic();
+    }
+
+    // Measured per-block cost of the amp model, the delay and the looper
+    const CycleMeter& AmpMeter() const {
+        return ampMeter;
+    }
+
+    const CycleMeter& DelayMeter() const {
+        return delayMeter;
+    }
+
+    const CycleMeter& LooperMeter() const {
+        return looperMeter;
+    }
+
+    // While the amp model is out (QUALITY_AMP_BYPASS): what running it over the
+    //   last block would have cost, share of a block of `size` samples at
+    //   `sample_rate`, extrapolated from its probe. Negative when it wasn't out.
+    float AmpOutLoad(size_t size, float sample_rate) const {
+        if (ampProbeScale == 0.0f) {
+            return -1.0f;
+        }
+        return ampProbeMeter.LastLoad(size, sample_rate) * ampProbeScale;
+    }
+
+    // size samples at the I/O rate
+    void Process(const float* in, float* outL, float* outR, size_t size, const EngineControls& c) {
+        ApplyPending();
+        if (!multirate) {
+            ProcessCore(in, outL, outR, size, c);
+            return;
+        }
+
+        const size_t n = size / 2;
+        if (bypass || size % 2 != 0 || n > MAX_BLOCK_SIZE) {
+            for (size_t i = 0; i < size; ++i) {
+                outL[i] = outR[i] = in[i];
+            }
+            mIR.SettleKernel();
+            return;
+        }
+        decimator.Process(in, core_in, n);
+        ProcessCore(core_in, core_outL, core_outR, n, c);
+        interpolatorL.Process(core_outL, outL, n);
+        interpolatorR.Process(core_outR, outR, n);
+    }
+
+    // Cost probes for the firmware's callback budget, timed by the caller.
+    // They disturb the effect state, call ResetEffects() afterwards.
+    float ProbeResampler(const float* in, size_t size) {
+        const size_t n = size / 2 < MAX_BLOCK_SIZE / 2 ? size / 2 : MAX_BLOCK_SIZE / 2;
+        decimator.Process(in, core_in, n);
+        interpolatorL.Process(core_in, core_outL, n);
+        interpolatorR.Process(core_in, core_outR, n);
+        return core_outL[0] + core_outR[0];
+    }
+
+    float ProbeEffects(const float* in, size_t size) {
+        if (size > MAX_BLOCK_SIZE) {
+            size = MAX_BLOCK_SIZE;
+        }
+        // Delay at its most expensive: on, both taps
+        bool on = delay.IsEnabled();
+        float second = delay.SecondTap();
+        delay.SetEnabled(true);
+        delay.SetSecondTap(0.75f);
+        for (size_t i = 0; i < size; i++) {
+            amp_out[i] = in[i];
+        }
+        delay.Process(amp_out, size);
+        delay.SetEnabled(on);
+        delay.SetSecondTap(second);
+
+        float acc = 0.0f;
+        for (size_t i = 0; i < size; i++) {
+            float f = tone.Process(amp_out[i]);
+            if (stereo_enabled) {
+                float l, r;
+                reverb.ProcessStereo(f, &l, &r);
+                acc += l + r;
+            } else {
+                acc += reverb.Process(f);
+            }
+        }
+        return acc;
+    }
+
+    float ProbeEcoCab(const float* in, size_t size) {
+        ecoCab.ApplyPending();      // before the audio starts nobody else picks it up
+        float acc = 0.0f;
+        for (size_t i = 0; i < size; i++) {
+            float l, r;
+            ecoCab.ProcessStereo(in[i], l, r);
+            acc += l + r;
+        }
+        return acc;
+    }
+
+    float ProbeIR(const float* in, size_t size) {
+        float acc = 0.0f;
+        for (size_t i = 0; i < size; i++) {
+            if (stereo_enabled) {
+                float l, r;
+                mIR.ProcessStereo(in[i], l, r);
+                acc += l + r;
+            } else {
+                acc += mIR.Process(in[i]);
+            }
+        }
+        return acc;
+    }
+
+    void ResetEffects() {
+        tone.Init(sample_rate);
+        delay.Reset();
+        reverb.Init(sample_rate, reverb_buffers);
+        mIR.Reset();
+        ecoCab.Reset();
+        sideLp = 0.0f;
+        if (multirate) {
+            decimator.Reset();
+            interpolatorL.Reset();
+            interpolatorR.Reset();
+        }
+    }
+
+  private:
+    float sample_rate;
+    bool bypass;
+
+    // Neural Network Model
+    // Snapshot models use input level as gain. Conditioned models take the knob
+    //   values as extra inputs; those are constant over a block, so their part of
+    //   the input projection is folded into the recurrent input bias once per block
+    //   and the per-sample forward stays a 1-input model.
+    //   The weights are never held here: a model in EngineWeights, or shared ones.
+    struct AmpSlot {
+        AmpModel* model = nullptr;                  // own weights and state, in EngineWeights
+        const SharedAmpModel* shared = nullptr;     // or shared weights, run on `state`
+        AmpState state;
+        WhLite lite;                // distilled stand-in for the model
+        bool useLite;
+        float levelAdjust;
+        int inSize;
+        const std::vector<std::vector<float>>* condWeights = nullptr;  // rec_weight_ih_l0 of the model
+        const std::vector<std::vector<float>>* recBias = nullptr;      // model bias in SetRecBias() layout
+        std::vector<std::vector<float>> condBias;   // recBias with the knob terms folded in
+        float condParams[MAX_COND_PARAMS];          // knob values condBias was computed for
+    };
+    AmpSlot amps[2];
+    EngineWeights* weights;
+    int ampActive;                  // slot the audio side runs, only it flips it
+    std::atomic<bool> ampPending;   // the other slot holds a newer model
+    float amp_in[MAX_BLOCK_SIZE];
+    float amp_out[MAX_BLOCK_SIZE];
+
+    ToneStage tone;             // LP/HP tone with built-in level compensation
+    TapDelay delay;
+    Looper looper;
+    CycleMeter ampMeter;
+    CycleMeter delayMeter;
+    CycleMeter looperMeter;
+    CycleMeter ampProbeMeter;
+    float ampProbeScale;        // block / probed samples, 0 if the amp wasn't probed
+
+    LiteReverb reverb;
+    float* reverb_buffers;
+    ImpulseResponse mIR;
+    EcoCab ecoCab;
+    float ecoMix;               // eco cab share of the cab output
+
+    // 96 kHz I/O
+    bool multirate = false;
+    HalfbandKernel halfband;
+    HalfbandDecimator decimator;
+    HalfbandInterpolator interpolatorL;
+    HalfbandInterpolator interpolatorR;
+    float core_in[MAX_BLOCK_SIZE];
+    float core_outL[MAX_BLOCK_SIZE];
+    float core_outR[MAX_BLOCK_SIZE];
+
+    float sideLp;               // side signal lowpass state
+    float sideLpCoef;
+
+    // Quality level and the fades it drives
+    QualityLevel quality;
+    float ampGain;              // amp model share, 0 = dry input only
+    float reverbWidth;          // right reverb lines' share, 0 = mono lines
+
+    void ResetAmp() {
+        AmpSlot& a = amps[ampActive];
+        if (a.useLite) {
+            a.lite.Reset();
+        } else if (a.shared) {
+            ResetAmpState(a.state);
+        } else if (a.model) {
+            ResetAmpModel(*a.model);
+        }
+    }
+
+    // Amp output without the skip path, on whichever weights the slot runs
+    void RunAmp(AmpSlot& a, const float* in, float* out, size_t size) {
+        if (a.useLite) {
+            a.lite.Process(in, out, size);
+        } else if (a.shared) {
+            ProcessSharedAmp(*a.shared, a.inSize > 1 ? a.condBias : *a.recBias, a.state, in, out, size);
+        } else if (a.model) {
+            ProcessAmpModel(*a.model, in, out, size);
+        } else {
+            memset(out, 0, size * sizeof(float));   // nothing loaded on an engine without weights
+        }
+    }
+
+    bool CanLoad(const modelData& md, bool lite) const {
+        return !(lite && !LiteAvailable(md)) && !ampPending.load(std::memory_order_acquire);
+    }
+
+    // Control context: the idle slot with what both kinds of load set alike
+    AmpSlot& BeginLoad(const modelData& md, bool lite) {
+        AmpSlot& a = amps[ampActive ^ 1];
+        a.shared = nullptr;
+        a.useLite = lite;
+        a.levelAdjust = md.levelAdjust;
+        a.inSize = md.inputSize;
+        a.condWeights = &md.rec_weight_ih_l0;
+        for (int k = 0; k < MAX_COND_PARAMS; k++) {
+            a.condParams[k] = -1.0f;    // force a bias update on the first block
+        }
+        return a;
+    }
+
+    // Block start, bypassed or not: take what the control context published
+    //   since the last block (model, IR kernel, eco cab)
+    void ApplyPending() {
+        if (ampPending.load(std::memory_order_acquire)) {
+            ampActive ^= 1;
+            ampPending.store(false, std::memory_order_release);
+        }
+        mIR.ApplyPendingKernel();
+        ecoCab.ApplyPending();
+    }
+
+    // Where a 0..1 fade of `fade` samples that started at `from` is after this block
+    static float RampEnd(float from, float to, float fade, size_t size) {
+        const float max = (float)size / fade;
+        if (to > from + max) return from + max;
+        if (to < from - max) return from - max;
+        return to;
+    }
+
+    // The chain at the core rate
+    void ProcessCore(const float* in, float* outL, float* outR, size_t size, const EngineControls& c) {
+        mIR.SetTrim(quality >= QUALITY_IR_TRIM ? IR_TRIM_LENGTH : 0);
+        ampProbeScale = 0.0f;
+        reverb.SetRoomSize(c.reverb_time);
+        reverb.SetDecay(c.reverb_decay);
+
+        AmpSlot& amp = amps[ampActive];
+        float vgain = c.gain;
+        // Conditioned models: the knobs drive the model instead of the input level
+        if (amp.inSize > 1) {
+            UpdateConditioning(amp, c.cond);
+            vgain = 1.0f;
+        }
+
+        // Mix and tone control
+        tone.SetFilter(c.filter);
+
+        // Calculate mix parameters
+        //    A cheap mostly energy constant crossfade from SignalSmith Blog
+        //    https://signalsmith-audio.co.uk/writing/2021/cheap-energy-crossfade/
+        float vmix = c.mix;
+        float x2 = 1.0 - vmix;
+        float A = vmix*x2;
+        float B = A * (1.0 + 1.4186 * A);
+        float C = B + vmix;
+        float D = B + x2;
+
+        float wetMix = C * C;
+        float dryMix = D * D;
+
+        if (bypass || size > MAX_BLOCK_SIZE) {
+            for (size_t i = 0; i < size; ++i) {
+                // Copy input to both outputs (mono-to-dual-mono)
+                outL[i] = outR[i] = in[i];
+            }
+            mIR.SettleKernel();     // not running, don't hold up the next kernel
+            return;
+        }
+
+        const float level = c.level;
+
+        // Neural, whole block at once on the active architecture
+        for (size_t i = 0; i < size; ++i) {
+            amp_in[i] = in[i] * vgain;
+        }
+        const float amp_target = rn_model_enabled && quality < QUALITY_AMP_BYPASS ? 1.0f : 0.0f;
+        if (amp_target > 0.0f || ampGain > 0.0f) {
+            if (ampGain == 0.0f) {
+                ResetAmp();             // coming back in, no stale state
+            }
+            ampMeter.Start();
+            RunAmp(amp, amp_in, amp_out, size);
+            ampMeter.Stop();
+            const float end = RampEnd(ampGain, amp_target, AMP_XFADE_SAMPLES, size);
+            const float step = (end - ampGain) / size;
+            float g = ampGain;
+            for (size_t i = 0; i < size; ++i) {
+                g += step;
+                float wet = (amp_out[i] + amp_in[i]) * amp.levelAdjust;
+                amp_out[i] = amp_in[i] + g * (wet - amp_in[i]);
+            }
+            ampGain = end;
+        } else {
+            if (rn_model_enabled && quality >= QUALITY_AMP_BYPASS) {
+                // Out under load: a short run keeps its cost known
+                const size_t n = size < AMP_PROBE_SAMPLES ? size : AMP_PROBE_SAMPLES;
+                ampProbeMeter.Start();
+                RunAmp(amp, amp_in, amp_out, n);
+                ampProbeMeter.Stop();
+                ampProbeScale = (float)size / n;
+            }
+            for (size_t i = 0; i < size; ++i) {
+                amp_out[i] = amp_in[i];
+            }
+        }
+
+        // Tone, level compensated, whole block
+        tone.Process(amp_out, size);
+
+        // Delay, SDRAM touched in bursts only
+        delayMeter.Start();
+        delay.Process(amp_out, size);
+        delayMeter.Stop();
+
+        // Looper, same burst access
+        looperMeter.Start();
+        looper.Process(amp_out, size);
+        looperMeter.Stop();
+
+        // Reverb width: the right lines only run while they're heard
+        const float width_target = quality >= QUALITY_REVERB_LITE ? 0.0f : 1.0f;
+        if (width_target > 0.0f && reverbWidth == 0.0f) {
+            reverb.ResumeRight();
+        }
+        const bool reverb_mono = reverbWidth == 0.0f && width_target == 0.0f;
+        const float width_end = RampEnd(reverbWidth, width_target, REVERB_WIDTH_FADE, size);
+        const float width_step = (width_end - reverbWidth) / size;
+        float width = reverbWidth;
+        reverbWidth = width_end;
+
+        // Cab type, whichever is switched to starts clean
+        const float eco_target = eco_cab_enabled && ecoCab.IsLoaded() ? 1.0f : 0.0f;
+        if (eco_target > 0.0f && ecoMix == 0.0f) {
+            ecoCab.Reset();
+        } else if (eco_target == 0.0f && ecoMix == 1.0f) {
+            mIR.Reset();
+        }
+        const float eco_end = RampEnd(ecoMix, eco_target, CAB_XFADE_SAMPLES, size);
+        const float eco_step = (eco_end - ecoMix) / size;
+        float eco = ecoMix;
+        ecoMix = eco_end;
+        if (!ir_enabled || (eco >= 1.0f && eco_end >= 1.0f)) {
+            mIR.SettleKernel();
+        }
+
+        for (size_t i = 0; i < size; ++i) {
+            float tone_out = amp_out[i];
+            eco += eco_step;
+
+            if (!stereo_enabled) {
+                float delay_out = reverb.Process(tone_out);
+
+                // IR
+                float y;
+                if (ir_enabled) {
+                    y = Cab(tone_out * dryMix + delay_out * wetMix, eco) * 0.2;
+                } else {
+                    y = tone_out * dryMix + delay_out * wetMix;
+                }
+
+                outL[i] = y * level;
+                outR[i] = y * level;
+                continue;
+            }
+
+            // Stereo: mid through the cab, side around it
+            float wetL, wetR;
+            if (reverb_mono) {
+                wetL = wetR = reverb.Process(tone_out);
+            } else {
+                reverb.ProcessStereo(tone_out, &wetL, &wetR);
+                width += width_step;
+                wetR = wetL + width * (wetR - wetL);
+            }
+            float mid = tone_out * dryMix + (wetL + wetR) * 0.5f * wetMix;
+            float side = (wetL - wetR) * 0.5f * wetMix;
+
+            float yl, yr;
+            if (ir_enabled) {
+                CabStereo(mid, eco, yl, yr);
+                yl *= 0.2f;
+                yr *= 0.2f;
+                sideLp += sideLpCoef * (side - sideLp);
+                side = sideLp;
+            } else {
+                yl = yr = mid;
+            }
+            side *= STEREO_SIDE_GAIN;
+
+            outL[i] = (yl + side) * level;
+            outR[i] = (yr - side) * level;
+        }
+    }
+
+    // FIR and/or eco cab, eco: 0..1 share of the eco cab
+    float Cab(float x, float eco) {
+        if (eco >= 1.0f) {
+            return ecoCab.Process(x);
+        }
+        float y = mIR.Process(x);
+        if (eco > 0.0f) {
+            y += eco * (ecoCab.Process(x) - y);
+        }
+        return y;
+    }
+
+    void CabStereo(float x, float eco, float& l, float& r) {
+        if (eco >= 1.0f) {
+            ecoCab.ProcessStereo(x, l, r);
+            return;
+        }
+        mIR.ProcessStereo(x, l, r);
+        if (eco > 0.0f) {
+            float el, er;
+            ecoCab.ProcessStereo(x, el, er);
+            l += eco * (el - l);
+            r += eco * (er - r);
+        }
+    }
+
+    // Fold the conditioning inputs into the recurrent input bias:
+    //   W_ih * [x, p1, p2] + b_ih = W_ih[0] * x + (b_ih + W_ih[1] * p1 + W_ih[2] * p2)
+    // Called once per block, only touches the model when a knob actually moved.
+    void UpdateConditioning(AmpSlot& a, const float* params) {
+        bool changed = false;
+        for (int k = 0; k < a.inSize - 1; k++) {
+            if (fabsf(params[k] - a.condParams[k]) > 0.001f) {
+                changed = true;
+            }
+        }
+        if (!changed) {
+            return;
+        }
+
+        const std::vector<std::vector<float>>& w = *a.condWeights;
+        for (size_t j = 0; j < a.condBias[0].size(); j++) {
+            float acc = (*a.recBias)[0][j];
+            for (int k = 1; k < a.inSize; k++) {
+                acc += w[k][j] * params[k - 1];
+            }
+            a.condBias[0][j] = acc;
+        }
+        for (int k = 0; k < a.inSize - 1; k++) {
+            a.condParams[k] = params[k];
+        }
+        if (!a.shared) {
+            SetRecBias(*a.model, a.condBias);       // shared weights read condBias as is
+        }
+    }
+};
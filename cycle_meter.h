@@ -0,0 +1,93 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Per-block cost of a stage, measured in the audio callback
+//   On the Daisy this reads the Cortex-M7 DWT cycle counter (one register read,
+//   cheap enough to leave in), on the host (ALTAIR_HOST) a steady clock in ns.
+//   Ticks() is the counter, TicksPerSecond() its rate.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ALTAIR_HOST
+#include <chrono>
+#else
+#include "stm32h7xx.h"
+#endif
+
+#define CYCLE_METER_SMOOTH 0.01f    // average over ~100 blocks
+
+class CycleMeter {
+  public:
+    static void Init() {
+#ifndef ALTAIR_HOST
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    }
+
+    static uint32_t Ticks() {
+#ifdef ALTAIR_HOST
+        return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+        return DWT->CYCCNT;
+#endif
+    }
+
+    static float TicksPerSecond() {
+#ifdef ALTAIR_HOST
+        return 1e9f;
+#else
+        return (float)SystemCoreClock;
+#endif
+    }
+
+    void Start() {
+        start = Ticks();
+    }
+
+    void Stop() {
+        last = Ticks() - start;     // wraps correctly
+        average += CYCLE_METER_SMOOTH * ((float)last - average);
+        if (last > peak) {
+            peak = last;
+        }
+    }
+
+    uint32_t Last() const { return last; }
+    uint32_t Peak() const { return peak; }
+    float Average() const { return average; }
+
+    // Average cost as a share of the time one block of `size` samples lasts
+    float Load(size_t size, float sample_rate) const {
+        return average * sample_rate / (TicksPerSecond() * size);
+    }
+
+    // Same for the last block only
+    float LastLoad(size_t size, float sample_rate) const {
+        return (float)last * sample_rate / (TicksPerSecond() * size);
+    }
+
+  private:
+    uint32_t start = 0;
+    uint32_t last = 0;
+    uint32_t peak = 0;
+    float average = 0.0f;
+};
@@ -0,0 +1,297 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Multi-stream host server (host build, `make server`)
+//   Runs N independent Altair chains (reamping sessions, practice-room feeds)
+//   block by block on a work-stealing pool. Each block: the I/O thread gathers
+//   one input block per channel, the pool processes every channel, the I/O
+//   thread writes the results out.
+//   Files stand in for the network: the input is raw 32-bit float mono at 48 kHz,
+//   looped, and channel k starts k blocks into it; outputs are raw 32-bit float
+//   stereo interleaved, one file per channel.
+//   Read-only data is loaded once and shared: one SharedAmpModel per model
+//   (recurrent weights, lite tables from the model table), and one ImpulseResponse
+//   per cab whose kernel every channel convolves with. The channels' engines get no
+//   EngineWeights, so they carry no weight arrays. Per channel state (GRU state,
+//   conditioning bias, tone, reverb and delay lines, IR history) is allocated by
+//   the worker that will run it, so it is first touched on, and stays cached by,
+//   that core.
+//   At startup every shared model is run against its RTNeural build and must
+//   match within SHARED_TOLERANCE.
+//
+//   usage: altair_server [-n channels] [-t threads] [-b block] [-s seconds]
+//                        [-i input.f32] [-o outdir] [-p]
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "altair_engine.h"
+#include "all_model_data_gru9_4count.h"
+#include "ImpulseResponse/ir_data.h"
+#include "work_stealing_pool.h"
+
+#define SAMPLE_RATE 48000.0f
+#define SHARED_TOLERANCE 1e-4f
+
+// One chain and its I/O blocks, kept together and cache line aligned
+struct alignas(64) Channel {
+    AltairEngine engine;
+    EngineControls ctl;
+    float in[MAX_BLOCK_SIZE];
+    float outL[MAX_BLOCK_SIZE];
+    float outR[MAX_BLOCK_SIZE];
+    std::vector<float> reverb_mem;
+    std::vector<float> delay_mem;
+    FILE* out = nullptr;
+};
+
+static void usage() {
+    fprintf(stderr, "usage: altair_server [-n channels] [-t threads] [-b block] [-s seconds]\n"
+                    "                     [-i input.f32] [-o outdir] [-p]\n");
+}
+
+// Plucked-string-ish test signal when no input file is given
+static std::vector<float> synth_input(size_t length) {
+    std::vector<float> x(length);
+    unsigned seed = 1;
+    float env = 0.0f, phase = 0.0f, freq = 110.0f;
+    for (size_t i = 0; i < length; i++) {
+        if (i % 24000 == 0) {
+            env = 0.6f;
+            freq = 82.4f * powf(2.0f, (float)((i / 24000) % 12) / 12.0f);
+        }
+        seed = seed * 1664525u + 1013904223u;
+        phase += 2.0f * (float)M_PI * freq / SAMPLE_RATE;
+        if (phase > 2.0f * (float)M_PI) phase -= 2.0f * (float)M_PI;
+        x[i] = env * (sinf(phase) + 0.3f * sinf(2.0f * phase)) + 0.002f * ((seed >> 9) * (1.0f / 8388608.0f) - 0.5f);
+        env *= 0.99985f;
+    }
+    return x;
+}
+
+// Largest difference between the shared forward and the RTNeural model over x
+static float shared_error(const SharedAmpModel& shared, const std::vector<float>& x) {
+    static AmpModel model;
+    AmpState state;
+    LoadModelWeights(model, *shared.md);
+    ResetAmpModel(model);
+    ResetAmpState(state);
+    std::vector<float> ref(x.size()), out(x.size());
+    ProcessAmpModel(model, x.data(), ref.data(), x.size());
+    ProcessSharedAmp(shared, shared.bias, state, x.data(), out.data(), x.size());
+    float err = 0.0f;
+    for (size_t i = 0; i < x.size(); i++) {
+        err = std::max(err, fabsf(out[i] - ref[i]));
+    }
+    return err;
+}
+
+static bool read_input(const char* path, std::vector<float>& x) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    float buf[4096];
+    size_t n;
+    while ((n = fread(buf, sizeof(float), 4096, f)) > 0) {
+        x.insert(x.end(), buf, buf + n);
+    }
+    fclose(f);
+    return !x.empty();
+}
+
+int main(int argc, char** argv) {
+    unsigned channels = 16;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t block = 256;
+    float seconds = 10.0f;
+    const char* in_path = nullptr;
+    const char* out_dir = nullptr;
+    bool pin = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:t:b:s:i:o:p")) != -1) {
+        switch (opt) {
+            case 'n': channels = (unsigned)atoi(optarg); break;
+            case 't': threads = (unsigned)atoi(optarg); break;
+            case 'b': block = (size_t)atoi(optarg); break;
+            case 's': seconds = (float)atof(optarg); break;
+            case 'i': in_path = optarg; break;
+            case 'o': out_dir = optarg; break;
+            case 'p': pin = true; break;
+            default: usage(); return 2;
+        }
+    }
+    if (channels == 0 || threads == 0 || block == 0 || block > MAX_BLOCK_SIZE) {
+        fprintf(stderr, "channels and threads must be > 0, block 1..%d\n", MAX_BLOCK_SIZE);
+        return 2;
+    }
+
+    std::vector<float> input;
+    if (in_path) {
+        if (!read_input(in_path, input)) {
+            fprintf(stderr, "can't read %s\n", in_path);
+            return 1;
+        }
+    } else {
+        input = synth_input((size_t)(4 * SAMPLE_RATE));
+    }
+
+    // Shared, read-only after this point
+    setupWeights();
+    std::vector<std::unique_ptr<SharedAmpModel>> models;
+    const std::vector<float> check(input.begin(), input.begin() + std::min(input.size(), (size_t)SAMPLE_RATE));
+    for (size_t k = 0; k < model_collection.size(); k++) {
+        models.emplace_back(new SharedAmpModel);
+        if (!PrepareSharedAmp(*models[k], model_collection[k])) {
+            fprintf(stderr, "model %zu doesn't fit its architecture\n", k + 1);
+            return 1;
+        }
+        const float err = shared_error(*models[k], check);
+        if (!(err <= SHARED_TOLERANCE)) {
+            fprintf(stderr, "model %zu: shared weights off RTNeural by %g\n", k + 1, err);
+            return 1;
+        }
+    }
+    std::vector<std::unique_ptr<IrKernelStore>> cab_stores;
+    std::vector<std::unique_ptr<ImpulseResponse>> cabs;
+    for (size_t k = 0; k < ir_collection.size(); k++) {
+        cab_stores.emplace_back(new IrKernelStore);
+        cabs.emplace_back(new ImpulseResponse);
+        const std::vector<float>& right = ir_collection_right[k];
+        cabs[k]->SetStore(cab_stores[k].get());
+        cabs[k]->Init(ir_collection[k].data(), right.empty() ? nullptr : right.data(), ir_collection[k].size());
+    }
+
+    WorkStealingPool pool(threads);
+    if (pin) {
+        pool.Pin();
+    }
+
+    // Each channel is built by the worker that will normally run it
+    std::vector<std::unique_ptr<Channel>> chans(channels);
+    pool.ParallelFor(channels, [&](size_t k) {
+        Channel* c = new Channel;
+        c->reverb_mem.assign(REVERB_MEM_SIZE, 0.0f);
+        c->delay_mem.assign(DELAY_MEM_SIZE, 0.0f);
+        c->engine.Init(SAMPLE_RATE, c->reverb_mem.data(), c->delay_mem.data());
+        c->engine.LoadModel(*models[k % models.size()]);
+        c->engine.LoadIR(*cabs[k % cabs.size()]);
+        c->engine.ToggleBypass();
+        c->engine.SetDelay(k % 2 == 1, 0.75f);
+
+        // Spread the settings a little so the channels aren't identical
+        float v = (float)k / channels;
+        c->ctl.gain = 0.5f + 1.5f * v;
+        c->ctl.mix = 0.3f;
+        c->ctl.level = 1.0f;
+        c->ctl.filter = 0.25f + 0.5f * v;
+        c->ctl.reverb_time = 0.4f;
+        c->ctl.reverb_decay = 0.5f;
+        c->ctl.cond[0] = c->ctl.cond[1] = 0.5f;
+        chans[k].reset(c);
+    });
+
+    if (out_dir) {
+        for (unsigned k = 0; k < channels; k++) {
+            std::string path = std::string(out_dir) + "/ch" + std::to_string(k) + ".f32";
+            chans[k]->out = fopen(path.c_str(), "wb");
+            if (!chans[k]->out) {
+                fprintf(stderr, "can't write %s\n", path.c_str());
+                return 1;
+            }
+        }
+    }
+
+    const long blocks = (long)(seconds * SAMPLE_RATE / block);
+    const double deadline_us = 1e6 * block / SAMPLE_RATE;
+    const std::function<void(size_t)> process = [&](size_t k) {
+        Channel& c = *chans[k];
+        c.engine.Process(c.in, c.outL, c.outR, block, c.ctl);
+    };
+
+    double proc_us = 0.0, worst_us = 0.0;
+    long late = 0;
+    std::vector<float> interleaved(2 * block);
+    pool.ResetStats();      // not the channel setup
+    auto wall_start = std::chrono::steady_clock::now();
+
+    for (long b = 0; b < blocks; b++) {
+        // Receive
+        for (unsigned k = 0; k < channels; k++) {
+            size_t pos = ((size_t)(b + k) * block) % input.size();
+            for (size_t i = 0; i < block; i++) {
+                chans[k]->in[i] = input[(pos + i) % input.size()];
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        pool.ParallelFor(channels, process);
+        auto end = std::chrono::steady_clock::now();
+
+        double us = std::chrono::duration<double, std::micro>(end - start).count();
+        proc_us += us;
+        worst_us = std::max(worst_us, us);
+        late += us > deadline_us;
+
+        // Send
+        if (out_dir) {
+            for (unsigned k = 0; k < channels; k++) {
+                for (size_t i = 0; i < block; i++) {
+                    interleaved[2 * i] = chans[k]->outL[i];
+                    interleaved[2 * i + 1] = chans[k]->outR[i];
+                }
+                fwrite(interleaved.data(), sizeof(float), 2 * block, chans[k]->out);
+            }
+        }
+    }
+
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    for (unsigned k = 0; k < channels; k++) {
+        if (chans[k]->out) {
+            fclose(chans[k]->out);
+        }
+    }
+
+    double audio_s = blocks * block / SAMPLE_RATE;
+    double realtime = channels * audio_s / (proc_us * 1e-6);   // channels' worth of real time per second
+    printf("channels:        %u, %u threads%s, block %zu\n", channels, pool.Threads(), pin ? " (pinned)" : "", block);
+    printf("audio:           %.1f s per channel, wall %.2f s\n", audio_s, wall_s);
+    printf("block cycle:     mean %.1f us, worst %.1f us, deadline %.1f us, %ld late\n",
+           proc_us / blocks, worst_us, deadline_us, late);
+    printf("throughput:      %.1f real-time channels\n", realtime);
+    printf("memory:          %.1f KB per channel plus its delay and reverb lines, %.1f KB shared weights\n",
+           sizeof(Channel) / 1024.0,
+           (models.size() * sizeof(SharedAmpModel) + cab_stores.size() * sizeof(IrKernelStore)) / 1024.0);
+    // Per worker: its channel blocks' worth of audio over the time it spent on them
+    for (unsigned w = 0; w < pool.Threads(); w++) {
+        const WorkStealingPool::WorkerStats s = pool.Stats(w);
+        const double worker_audio_s = s.jobs * block / SAMPLE_RATE;
+        printf("  worker %-3u     %ld channel blocks, %.1f s of audio in %.2f s busy, %.1fx real time, busy %.0f%% of the cycle\n",
+               w, (long)s.jobs, worker_audio_s, s.busy_s, s.busy_s > 0.0 ? worker_audio_s / s.busy_s : 0.0,
+               100.0 * s.busy_s / (proc_us * 1e-6));
+    }
+    printf("steals:          %zu of %ld jobs\n", pool.Steals(), blocks * (long)channels);
+    return 0;
+}
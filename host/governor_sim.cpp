@@ -0,0 +1,255 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Load governor simulation (host build, `make governor-sim`)
+//   Runs the real engine block by block with the governor closing the loop the
+//   way AudioCallback does. The host is much faster than the Daisy, so each
+//   block is charged a synthetic per-stage cost (share of the block period)
+//   standing in for the Daisy's: amp model, reverb, cab. The injected cost
+//   follows the quality level (trimmed IR costs IR_TRIM_LENGTH/len, lite reverb
+//   half, bypassed amp only its AMP_PROBE_SAMPLES probe), so stepping down
+//   really helps. The amp probe reports the amp's full cost to the governor,
+//   as the engine's does in the firmware.
+//   By default the cost is added to the block's load in virtual time with a
+//   seeded jitter, so runs are reproducible; -w spins for it instead and the
+//   governor sees the measured wall clock time (host preemption included).
+//   Scenario: normal load, then from 20% to 50% of the run one stage gets
+//   `factor` times slower, then normal again. Transitions are read from the
+//   log ring between blocks, like the firmware's main loop.
+//   Each scenario's default factor is sized to need a given step: a slow cab is
+//   covered by trimming it, a slow reverb needs the lite reverb as well, since
+//   trimming the cab alone leaves it over the limit, and a slow amp needs the
+//   amp bypassed.
+//   Fails (exit 1) if the governor doesn't end back at full quality, flaps,
+//   misses a single deadline once it has reacted (stepped down to where the
+//   load fits), or (at the default factor, in virtual time) doesn't step down
+//   to the scenario's level and no further. With -w host preemption adds to the
+//   load, so the level isn't checked and a miss in a thousand blocks is let go.
+//
+//   usage: governor_sim [-s seconds] [-x amp|reverb|ir] [-f factor]
+//                       [-a amp] [-r reverb] [-i ir] [-j jitter] [-w]
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+
+#include "altair_engine.h"
+#include "all_model_data_gru9_4count.h"
+#include "ImpulseResponse/ir_data.h"
+
+#define SAMPLE_RATE 48000.0f
+#define BLOCK_SIZE 256
+#define MAX_TRANSITIONS 12          // more than this over the scenario is flapping
+
+struct Scenario {
+    const char* slow;
+    float factor;
+    QualityLevel lowest;            // where the governor should bottom out
+};
+
+static const Scenario scenarios[] = {
+    { "ir", 3.0f, QUALITY_IR_TRIM },
+    { "reverb", 5.0f, QUALITY_REVERB_LITE },
+    { "amp", 3.0f, QUALITY_AMP_BYPASS },
+};
+
+static float reverb_mem[REVERB_MEM_SIZE];
+static float delay_mem[DELAY_MEM_SIZE];
+static AltairEngine engine;
+static EngineWeights engine_weights;
+static GovernorLog governor_log;
+static LoadGovernor governor;
+
+static void usage() {
+    fprintf(stderr, "usage: governor_sim [-s seconds] [-x amp|reverb|ir] [-f factor]\n"
+                    "                    [-a amp] [-r reverb] [-i ir] [-j jitter] [-w]\n");
+}
+
+// Busy wait, the synthetic stage has to show up in the measured callback time
+static void spin(float seconds) {
+    const uint32_t start = CycleMeter::Ticks();
+    const uint32_t ticks = (uint32_t)(seconds * CycleMeter::TicksPerSecond());
+    while (CycleMeter::Ticks() - start < ticks) {
+    }
+}
+
+int main(int argc, char** argv) {
+    float seconds = 40.0f;
+    const char* slow = "ir";
+    float factor = 0.0f;            // the scenario's
+    float amp_cost = 0.35f, reverb_cost = 0.10f, ir_cost = 0.15f;
+    float jitter = 0.05f;
+    bool wall = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:x:f:a:r:i:j:w")) != -1) {
+        switch (opt) {
+            case 's': seconds = (float)atof(optarg); break;
+            case 'x': slow = optarg; break;
+            case 'f': factor = (float)atof(optarg); break;
+            case 'a': amp_cost = (float)atof(optarg); break;
+            case 'r': reverb_cost = (float)atof(optarg); break;
+            case 'i': ir_cost = (float)atof(optarg); break;
+            case 'j': jitter = (float)atof(optarg); break;
+            case 'w': wall = true; break;
+            default: usage(); return 2;
+        }
+    }
+    const Scenario* scenario = nullptr;
+    for (const Scenario& s : scenarios) {
+        if (strcmp(slow, s.slow) == 0) {
+            scenario = &s;
+        }
+    }
+    if (scenario == nullptr) {
+        usage();
+        return 2;
+    }
+    const bool default_factor = factor == 0.0f;
+    if (default_factor) {
+        factor = scenario->factor;
+    }
+
+    setupWeights();
+    engine.Init(SAMPLE_RATE, reverb_mem, delay_mem, nullptr, &engine_weights);
+    engine.LoadModel(model_collection[0]);
+    engine.LoadIR(ir_collection[0]);
+    engine.ToggleBypass();
+    governor.Init(GovernorConfig(), &governor_log);
+    CycleMeter callback_meter;
+
+    EngineControls ctl;
+    ctl.gain = 1.0f;
+    ctl.mix = 0.3f;
+    ctl.level = 1.0f;
+    ctl.filter = 0.5f;
+    ctl.reverb_time = 0.5f;
+    ctl.reverb_decay = 0.5f;
+    ctl.cond[0] = ctl.cond[1] = 0.5f;
+
+    const float period = BLOCK_SIZE / SAMPLE_RATE;
+    const float trim = fminf(1.0f, (float)IR_TRIM_LENGTH / ir_collection[0].size());
+    const long blocks = (long)(seconds / period);
+    const long slow_from = blocks / 5, slow_to = blocks / 2;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+    long late = 0, late_after_react = 0, transitions = 0;
+    long blocks_at[QUALITY_COUNT] = {};
+    long react_block = -1;
+    float in[BLOCK_SIZE], outL[BLOCK_SIZE], outR[BLOCK_SIZE];
+    float phase = 0.0f;
+
+    printf("scenario:        %.1f s, %s x%.1f from %.1f s to %.1f s\n", seconds, slow, factor,
+           slow_from * period, slow_to * period);
+    printf("stage costs:     amp %.0f%%, reverb %.0f%%, IR %.0f%% of the block period, %s\n",
+           100.0f * amp_cost, 100.0f * reverb_cost, 100.0f * ir_cost,
+           wall ? "spun in wall clock time" : "virtual time");
+
+    for (long b = 0; b < blocks; b++) {
+        for (size_t i = 0; i < BLOCK_SIZE; i++) {
+            phase += 2.0f * (float)M_PI * 110.0f / SAMPLE_RATE;
+            if (phase > 2.0f * (float)M_PI) phase -= 2.0f * (float)M_PI;
+            in[i] = 0.4f * sinf(phase);
+        }
+
+        // The slow stage
+        const bool slowed = b >= slow_from && b < slow_to;
+        float amp = amp_cost, reverb = reverb_cost, ir = ir_cost;
+        if (slowed) {
+            if (strcmp(slow, "amp") == 0) amp *= factor;
+            if (strcmp(slow, "reverb") == 0) reverb *= factor;
+            if (strcmp(slow, "ir") == 0) ir *= factor;
+        }
+        const QualityLevel q = engine.Quality();
+        if (q >= QUALITY_IR_TRIM) ir *= trim;
+        if (q >= QUALITY_REVERB_LITE) reverb *= 0.5f;
+        const float amp_full = amp;
+        if (q >= QUALITY_AMP_BYPASS) amp *= (float)AMP_PROBE_SAMPLES / BLOCK_SIZE;
+        blocks_at[q]++;
+
+        // Callback
+        const float stages = amp + reverb + ir;
+        callback_meter.Start();
+        engine.Process(in, outL, outR, BLOCK_SIZE, ctl);
+        if (wall) {
+            spin(stages * period);
+        }
+        callback_meter.Stop();
+        float load = callback_meter.LastLoad(BLOCK_SIZE, SAMPLE_RATE);
+        if (!wall) {
+            load = fminf(load, 0.05f) + stages + jitter * uni(rng);
+        }
+        const float amp_out = engine.AmpOutLoad(BLOCK_SIZE, SAMPLE_RATE);
+        if (amp_out >= 0.0f) {
+            governor.Remeasure(QUALITY_AMP_BYPASS, amp_out + amp_full);
+        }
+        engine.SetQuality(governor.Update(load));
+
+        // Main loop
+        if (load > 1.0f) {
+            late++;
+            // Counted once the governor is out of steps or the slow stage is over
+            if (react_block >= 0 && b > react_block) {
+                late_after_react++;
+            }
+        }
+        GovernorEvent e;
+        while (governor_log.Pop(e)) {
+            printf("  %7.2f s  %-12s -> %-12s load %3.0f%%\n", e.block * period, qualityName[e.from],
+                   qualityName[e.to], 100.0f * e.load);
+            transitions++;
+        }
+        if (react_block < 0 && slowed && governor.Level() != QUALITY_FULL) {
+            // Give it the steps it needs to get down to where it fits
+            react_block = b + (long)QUALITY_COUNT * (GovernorConfig().settle_blocks + GovernorConfig().step_down_blocks);
+        }
+    }
+
+    printf("time at level:  ");
+    for (int q = 0; q < QUALITY_COUNT; q++) {
+        printf(" %s %.1f s%s", qualityName[q], blocks_at[q] * period, q + 1 < QUALITY_COUNT ? "," : "\n");
+    }
+    printf("lowest level:    %s\n", qualityName[governor.PeakLevel()]);
+    printf("deadline misses: %ld, %ld after the governor reacted\n", late, late_after_react);
+    printf("transitions:     %ld\n", transitions);
+
+    bool ok = true;
+    if (governor.Level() != QUALITY_FULL) {
+        printf("FAIL: still at %s when the load is back to normal\n", qualityName[governor.Level()]);
+        ok = false;
+    }
+    if (transitions > MAX_TRANSITIONS) {
+        printf("FAIL: %ld transitions, the governor is flapping\n", transitions);
+        ok = false;
+    }
+    if (late_after_react > (wall ? blocks / 1000 : 0)) {
+        printf("FAIL: deadlines still missed after the governor reacted\n");
+        ok = false;
+    }
+    if (default_factor && !wall && governor.PeakLevel() != scenario->lowest) {
+        printf("FAIL: went down to %s, the scenario needs %s\n", qualityName[governor.PeakLevel()],
+               qualityName[scenario->lowest]);
+        ok = false;
+    }
+    if (ok) {
+        printf("OK\n");
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,438 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Eco cab fitter (host build, `make ir-fit`)
+//   Approximates every IR in ir_collection (and ir_collection_right) with a
+//   cascade of biquads for the EcoCab stage and writes ImpulseResponse/ir_eco_data.h.
+//   Magnitude-domain fit: the target is the IR's response as the FIR plays it
+//   (truncated to IR_MAX_LENGTH), 1/6 octave smoothed, in dB on a log frequency
+//   grid. The cascade is a 2nd order highpass and lowpass for the cab's band
+//   edges plus peaking sections: each new peak goes where the error is largest,
+//   then Levenberg-Marquardt refits every section's frequency, gain and Q.
+//   A cascade of biquads is minimum phase; a close mic'd cab nearly is, so
+//   matching the magnitude is what's audible.
+//   Reports the error against the smoothed response, weighted 50 Hz..10 kHz.
+//
+//   usage: ir_fit [-n sections] [-o output.h]
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "ImpulseResponse/ImpulseResponse.h"
+#include "ImpulseResponse/EcoCab.h"
+#include "ImpulseResponse/ir_data.h"
+
+#define SAMPLE_RATE 48000.0
+#define GRID_POINTS 240
+#define GRID_LOW 20.0
+#define GRID_HIGH 20000.0
+#define SMOOTH_OCTAVES (1.0 / 6.0)
+#define LM_ITERATIONS 60
+#define SEED_LOBES 4
+
+enum SectionType { SEC_HIGHPASS, SEC_LOWPASS, SEC_PEAK };
+
+// One biquad, the fitted parameters are log(f), gain dB, log(Q)
+struct Section {
+    SectionType type;
+    double logf, gain, logq;
+};
+
+struct Coefs {
+    double b0, b1, b2, a1, a2;
+};
+
+// RBJ cookbook
+static Coefs design(const Section& s) {
+    const double f = exp(s.logf), q = exp(s.logq);
+    const double w = 2.0 * M_PI * f / SAMPLE_RATE;
+    const double cw = cos(w), alpha = sin(w) / (2.0 * q);
+    double b0, b1, b2, a0, a1, a2;
+    if (s.type == SEC_HIGHPASS) {
+        b0 = (1.0 + cw) / 2.0; b1 = -(1.0 + cw); b2 = b0;
+        a0 = 1.0 + alpha; a1 = -2.0 * cw; a2 = 1.0 - alpha;
+    } else if (s.type == SEC_LOWPASS) {
+        b0 = (1.0 - cw) / 2.0; b1 = 1.0 - cw; b2 = b0;
+        a0 = 1.0 + alpha; a1 = -2.0 * cw; a2 = 1.0 - alpha;
+    } else {
+        const double A = pow(10.0, s.gain / 40.0);
+        b0 = 1.0 + alpha * A; b1 = -2.0 * cw; b2 = 1.0 - alpha * A;
+        a0 = 1.0 + alpha / A; a1 = -2.0 * cw; a2 = 1.0 - alpha / A;
+    }
+    return { b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0 };
+}
+
+// Grid point with its trig precomputed
+struct GridPoint {
+    double f;
+    double c1, s1, c2, s2;
+};
+
+static double magnitude_db(const Coefs& c, const GridPoint& g) {
+    const double nr = c.b0 + c.b1 * g.c1 + c.b2 * g.c2, ni = -(c.b1 * g.s1 + c.b2 * g.s2);
+    const double dr = 1.0 + c.a1 * g.c1 + c.a2 * g.c2, di = -(c.a1 * g.s1 + c.a2 * g.s2);
+    return 10.0 * log10((nr * nr + ni * ni) / (dr * dr + di * di) + 1e-30);
+}
+
+struct Fit {
+    std::vector<GridPoint> grid;
+    std::vector<double> target;     // dB
+    std::vector<double> weight;
+    double gain = 0.0;              // overall, dB
+    std::vector<Section> sections;
+    std::vector<std::vector<double>> response;  // per section, dB on the grid
+
+    void Update(size_t s) {
+        response.resize(sections.size());
+        response[s].resize(grid.size());
+        const Coefs c = design(sections[s]);
+        for (size_t k = 0; k < grid.size(); k++) {
+            response[s][k] = magnitude_db(c, grid[k]);
+        }
+    }
+
+    void UpdateAll() {
+        for (size_t s = 0; s < sections.size(); s++) Update(s);
+    }
+
+    double Model(size_t k) const {
+        double db = gain;
+        for (size_t s = 0; s < sections.size(); s++) {
+            db += response[s][k];
+        }
+        return db;
+    }
+
+    // Weighted squared error
+    double Cost() const {
+        double e = 0.0;
+        for (size_t k = 0; k < grid.size(); k++) {
+            const double d = Model(k) - target[k];
+            e += weight[k] * d * d;
+        }
+        return e;
+    }
+
+    // Parameter vector: gain, then per section the free parameters
+    std::vector<double> Params() const {
+        std::vector<double> p = { gain };
+        for (const Section& s : sections) {
+            p.push_back(s.logf);
+            p.push_back(s.logq);
+            if (s.type == SEC_PEAK) p.push_back(s.gain);
+        }
+        return p;
+    }
+
+    void SetParams(const std::vector<double>& p) {
+        size_t i = 0;
+        gain = p[i++];
+        for (size_t n = 0; n < sections.size(); n++) {
+            Section& s = sections[n];
+            const Section old = s;
+            s.logf = std::min(std::max(p[i++], log(GRID_LOW)), log(0.45 * SAMPLE_RATE));
+            const double qmax = s.type == SEC_PEAK ? 12.0 : 2.0;
+            s.logq = std::min(std::max(p[i++], log(0.3)), log(qmax));
+            if (s.type == SEC_PEAK) s.gain = std::min(std::max(p[i++], -36.0), 24.0);
+            if (n >= response.size() || s.logf != old.logf || s.logq != old.logq || s.gain != old.gain) {
+                Update(n);
+            }
+        }
+    }
+};
+
+// Response of the IR on the grid, power averaged over SMOOTH_OCTAVES
+static void make_target(const float* ir, size_t length, Fit& fit) {
+    const int fine = 8 * GRID_POINTS;
+    std::vector<double> ff(fine), pw(fine);
+    for (int j = 0; j < fine; j++) {
+        ff[j] = GRID_LOW * pow(GRID_HIGH / GRID_LOW, (double)j / (fine - 1));
+        const double w = 2.0 * M_PI * ff[j] / SAMPLE_RATE;
+        double re = 0.0, im = 0.0;
+        for (size_t n = 0; n < length; n++) {
+            re += ir[n] * cos(w * n);
+            im -= ir[n] * sin(w * n);
+        }
+        pw[j] = re * re + im * im;
+    }
+    const double span = SMOOTH_OCTAVES / 2.0 / log2(GRID_HIGH / GRID_LOW) * (fine - 1);
+    fit.grid.resize(GRID_POINTS);
+    fit.target.resize(GRID_POINTS);
+    fit.weight.resize(GRID_POINTS);
+    for (int k = 0; k < GRID_POINTS; k++) {
+        const double center = (double)k / (GRID_POINTS - 1) * (fine - 1);
+        const int lo = std::max(0, (int)(center - span)), hi = std::min(fine - 1, (int)(center + span));
+        double acc = 0.0;
+        for (int j = lo; j <= hi; j++) acc += pw[j];
+        const double f = ff[(int)center];
+        const double w = 2.0 * M_PI * f / SAMPLE_RATE;
+        fit.grid[k] = { f, cos(w), sin(w), cos(2.0 * w), sin(2.0 * w) };
+        fit.target[k] = 10.0 * log10(acc / (hi - lo + 1) + 1e-12);
+        // What a guitar cab is about, the extremes count less
+        fit.weight[k] = f < 50.0 || f > 10000.0 ? (f > 16000.0 ? 0.05 : 0.3) : 1.0;
+    }
+}
+
+// Solve A x = b in place, n small (Gaussian elimination, partial pivoting)
+static bool solve(std::vector<double>& A, std::vector<double>& b, size_t n) {
+    for (size_t c = 0; c < n; c++) {
+        size_t piv = c;
+        for (size_t r = c + 1; r < n; r++) {
+            if (fabs(A[r * n + c]) > fabs(A[piv * n + c])) piv = r;
+        }
+        if (fabs(A[piv * n + c]) < 1e-18) return false;
+        if (piv != c) {
+            for (size_t j = 0; j < n; j++) std::swap(A[c * n + j], A[piv * n + j]);
+            std::swap(b[c], b[piv]);
+        }
+        for (size_t r = c + 1; r < n; r++) {
+            const double m = A[r * n + c] / A[c * n + c];
+            for (size_t j = c; j < n; j++) A[r * n + j] -= m * A[c * n + j];
+            b[r] -= m * b[c];
+        }
+    }
+    for (size_t c = n; c-- > 0;) {
+        for (size_t j = c + 1; j < n; j++) b[c] -= A[c * n + j] * b[j];
+        b[c] /= A[c * n + c];
+    }
+    return true;
+}
+
+// Levenberg-Marquardt over all parameters, numerical Jacobian
+static void refine(Fit& fit) {
+    std::vector<double> p = fit.Params();
+    const size_t n = p.size(), m = fit.grid.size();
+    double lambda = 1e-2;
+    double cost = fit.Cost();
+    std::vector<double> J(m * n), r(m);
+    for (int it = 0; it < LM_ITERATIONS; it++) {
+        for (size_t k = 0; k < m; k++) {
+            r[k] = sqrt(fit.weight[k]) * (fit.Model(k) - fit.target[k]);
+        }
+        for (size_t i = 0; i < n; i++) {
+            std::vector<double> q = p;
+            const double h = 1e-4;
+            q[i] += h;
+            fit.SetParams(q);
+            for (size_t k = 0; k < m; k++) {
+                J[k * n + i] = (sqrt(fit.weight[k]) * (fit.Model(k) - fit.target[k]) - r[k]) / h;
+            }
+            fit.SetParams(p);
+        }
+
+        bool improved = false;
+        while (!improved && lambda < 1e6) {
+            std::vector<double> A(n * n, 0.0), g(n, 0.0);
+            for (size_t i = 0; i < n; i++) {
+                for (size_t k = 0; k < m; k++) g[i] -= J[k * n + i] * r[k];
+                for (size_t j = 0; j <= i; j++) {
+                    double acc = 0.0;
+                    for (size_t k = 0; k < m; k++) acc += J[k * n + i] * J[k * n + j];
+                    A[i * n + j] = A[j * n + i] = acc;
+                }
+            }
+            for (size_t i = 0; i < n; i++) A[i * n + i] *= 1.0 + lambda;
+            if (!solve(A, g, n)) {
+                lambda *= 10.0;
+                continue;
+            }
+            std::vector<double> q = p;
+            for (size_t i = 0; i < n; i++) q[i] += g[i];
+            fit.SetParams(q);
+            const double c = fit.Cost();
+            if (c < cost) {
+                cost = c;
+                p = fit.Params();
+                lambda = std::max(lambda * 0.3, 1e-7);
+                improved = true;
+            } else {
+                fit.SetParams(p);
+                lambda *= 10.0;
+            }
+        }
+        if (!improved) break;
+    }
+}
+
+static void fit_ir(const float* ir, size_t length, int count, Fit& fit) {
+    make_target(ir, length, fit);
+
+    // Level: the mid band
+    double acc = 0.0;
+    int cnt = 0;
+    for (size_t k = 0; k < fit.grid.size(); k++) {
+        if (fit.grid[k].f > 200.0 && fit.grid[k].f < 3000.0) {
+            acc += fit.target[k];
+            cnt++;
+        }
+    }
+    fit.gain = acc / cnt;
+
+    // Band edges where the response has dropped 6 dB from that level
+    double lo = 60.0, hi = 6000.0;
+    for (size_t k = 0; k < fit.grid.size() && fit.grid[k].f < 500.0; k++) {
+        if (fit.target[k] > fit.gain - 6.0) { lo = fit.grid[k].f; break; }
+    }
+    for (size_t k = fit.grid.size(); k-- > 0 && fit.grid[k].f > 2000.0;) {
+        if (fit.target[k] > fit.gain - 6.0) { hi = fit.grid[k].f; break; }
+    }
+    fit.sections.push_back({ SEC_HIGHPASS, log(lo), 0.0, log(0.707) });
+    fit.sections.push_back({ SEC_LOWPASS, log(hi), 0.0, log(0.707) });
+    fit.UpdateAll();
+    refine(fit);
+
+    // Peaks where the error is worst: seed one at each of the largest error
+    // lobes, narrow and wide, keep whichever refits best
+    while ((int)fit.sections.size() < count) {
+        std::vector<std::pair<double, size_t>> lobes;
+        double prev = 0.0;
+        for (size_t k = 0; k < fit.grid.size(); k++) {
+            const double e = fit.target[k] - fit.Model(k);
+            const double next = k + 1 < fit.grid.size() ? fit.target[k + 1] - fit.Model(k + 1) : 0.0;
+            const double a = fit.weight[k] * fabs(e);
+            if (a >= fit.weight[k] * fabs(prev) && a >= fit.weight[k] * fabs(next)) {
+                lobes.push_back({ a, k });
+            }
+            prev = e;
+        }
+        std::sort(lobes.rbegin(), lobes.rend());
+        lobes.resize(std::min(lobes.size(), (size_t)SEED_LOBES));
+
+        Fit best = fit;
+        double best_cost = HUGE_VAL;
+        for (const auto& l : lobes) {
+            for (double q : { 1.0, 4.0 }) {
+                Fit trial = fit;
+                const size_t k = l.second;
+                const double g = std::min(std::max(fit.target[k] - fit.Model(k), -36.0), 24.0);
+                trial.sections.push_back({ SEC_PEAK, log(fit.grid[k].f), g, log(q) });
+                trial.UpdateAll();
+                refine(trial);
+                const double c = trial.Cost();
+                if (c < best_cost) {
+                    best_cost = c;
+                    best = trial;
+                }
+            }
+        }
+        fit = best;
+    }
+}
+
+// RMS and max error in dB, weighted band only
+static void fit_error(const Fit& fit, double& rms, double& max) {
+    double acc = 0.0;
+    int cnt = 0;
+    max = 0.0;
+    for (size_t k = 0; k < fit.grid.size(); k++) {
+        if (fit.grid[k].f < 50.0 || fit.grid[k].f > 10000.0) continue;
+        const double d = fabs(fit.Model(k) - fit.target[k]);
+        acc += d * d;
+        cnt++;
+        max = std::max(max, d);
+    }
+    rms = sqrt(acc / cnt);
+}
+
+static void write_data(FILE* out, const char* name, const Fit& fit) {
+    fprintf(out, "const EcoCabData %s = { %zu, {\n", name, fit.sections.size());
+    const double g = pow(10.0, fit.gain / 20.0);
+    for (size_t s = 0; s < fit.sections.size(); s++) {
+        Coefs c = design(fit.sections[s]);
+        const double k = s == 0 ? g : 1.0;     // overall gain in the first section
+        fprintf(out, "    { %.9g, %.9g, %.9g, %.9g, %.9g },\n", k * c.b0, k * c.b1, k * c.b2, c.a1, c.a2);
+    }
+    fprintf(out, "} };\n");
+}
+
+int main(int argc, char** argv) {
+    int count = 12;
+    const char* out_path = "ImpulseResponse/ir_eco_data.h";
+    int opt;
+    while ((opt = getopt(argc, argv, "n:o:")) != -1) {
+        switch (opt) {
+            case 'n': count = atoi(optarg); break;
+            case 'o': out_path = optarg; break;
+            default:
+                fprintf(stderr, "usage: ir_fit [-n sections] [-o output.h]\n");
+                return 2;
+        }
+    }
+    if (count < 2 || count > ECO_MAX_SECTIONS) {
+        fprintf(stderr, "sections must be 2..%d\n", ECO_MAX_SECTIONS);
+        return 2;
+    }
+
+    FILE* out = fopen(out_path, "w");
+    if (!out) {
+        fprintf(stderr, "can't write %s\n", out_path);
+        return 1;
+    }
+    fprintf(out, "// Eco cab data, generated by host/ir_fit from ir_data.h (`make ir-fit`), don't edit.\n");
+    fprintf(out, "// Biquads as { b0, b1, b2, a1, a2 }, same order as ir_collection.\n");
+    fprintf(out, "// Error vs the 1/6 octave smoothed IR response, 50 Hz..10 kHz:\n");
+
+    std::vector<Fit> fits[2];
+    for (int side = 0; side < 2; side++) {
+        const std::vector<std::vector<float>>& irs = side == 0 ? ir_collection : ir_collection_right;
+        for (size_t i = 0; i < irs.size(); i++) {
+            Fit fit;
+            if (!irs[i].empty()) {
+                const size_t length = std::min(irs[i].size(), (size_t)IR_MAX_LENGTH);
+                fit_ir(irs[i].data(), length, count, fit);
+                double rms, max;
+                fit_error(fit, rms, max);
+                printf("IR %zu%s: %zu taps -> %zu biquads, %.2f dB RMS, %.2f dB max error\n", i + 1,
+                       side ? " right" : "", length, fit.sections.size(), rms, max);
+                fprintf(out, "//   IR %zu%s: %zu taps -> %zu biquads, %.2f dB RMS, %.2f dB max\n", i + 1,
+                        side ? " right" : "", length, fit.sections.size(), rms, max);
+            }
+            fits[side].push_back(fit);
+        }
+    }
+
+    fprintf(out, "\n#pragma once\n\n#include <vector>\n#include \"EcoCab.h\"\n\n");
+    for (int side = 0; side < 2; side++) {
+        for (size_t i = 0; i < fits[side].size(); i++) {
+            if (fits[side][i].sections.empty()) continue;
+            char name[64];
+            snprintf(name, sizeof(name), "ir_eco_data%zu%s", i + 1, side ? "_right" : "");
+            write_data(out, name, fits[side][i]);
+            fprintf(out, "\n");
+        }
+    }
+    for (int side = 0; side < 2; side++) {
+        fprintf(out, "%s", side == 0 ? "std::vector<EcoCabData> ir_eco_collection = { "
+                                     : "// Empty (0 sections) where the cab is mono\n"
+                                       "std::vector<EcoCabData> ir_eco_collection_right = { ");
+        for (size_t i = 0; i < fits[side].size(); i++) {
+            if (fits[side][i].sections.empty()) {
+                fprintf(out, "%s{}", i ? ", " : "");
+            } else {
+                fprintf(out, "%sir_eco_data%zu%s", i ? ", " : "", i + 1, side ? "_right" : "");
+            }
+        }
+        fprintf(out, " };\n");
+    }
+    fclose(out);
+    printf("wrote %s\n", out_path);
+    return 0;
+}
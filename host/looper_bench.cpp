@@ -0,0 +1,292 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Looper bench (host build, `make looper-bench`)
+//   First the gestures on a bare Looper with known signals: record, the loop
+//   point crossfade, overdub, stop, play from the start, clear, a too short
+//   recording, and a recording that fills the buffer. Playback has to match
+//   what was put in to float precision.
+//   Then the looper in the engine, with the model and cab running, through a
+//   script of record / play / overdub / stop for the given time. The buffer is
+//   the full LOOPER_MEM_SIZE in host DRAM, far past any cache. The Daisy's
+//   SDRAM is stood in for by a latency model charged on the looper's counted
+//   bursts and words (SDRAM_BURST_NS per burst, SDRAM_NS_PER_WORD after that).
+//   Reports the looper's per-block cost (measured plus modeled SDRAM time) next
+//   to the amp model's, and the SDRAM bandwidth it takes.
+//   Fails (exit 1) on wrong playback, more than four bursts in a block, or if
+//   the looper takes more than LOOPER_BUDGET of the block period. That's judged
+//   on the 99.9th percentile block, the few worst ones on a desktop are the host
+//   preempting the bench.
+//
+//   usage: looper_bench [-s seconds]
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "altair_engine.h"
+#include "all_model_data_gru9_4count.h"
+#include "ImpulseResponse/ir_data.h"
+
+#define SAMPLE_RATE 48000.0f
+#define BLOCK_SIZE 256
+#define SDRAM_BURST_NS 200.0f       // row open, CAS latency and bus turnaround per burst
+#define SDRAM_NS_PER_WORD 20.0f     // 32-bit words streamed after that, ~200 MB/s
+#define LOOPER_BUDGET 0.02f         // share of the block period
+#define MATCH_TOLERANCE 1e-5f
+
+static float reverb_mem[REVERB_MEM_SIZE];
+static float delay_mem[DELAY_MEM_SIZE];
+static AltairEngine engine;
+static EngineWeights engine_weights;
+static Looper looper;
+
+static bool ok = true;
+
+static void check(bool pass, const char* what) {
+    printf("  %-52s %s\n", what, pass ? "ok" : "FAIL");
+    ok &= pass;
+}
+
+static float sine(long n, float freq, float amp) {
+    return amp * sinf(2.0f * (float)M_PI * freq * (float)n / SAMPLE_RATE);
+}
+
+// Blocks of a sine through the bare looper, action (if any) taken at the first
+//   one. Returns the output.
+static std::vector<float> run(Looper::Action action, long blocks, long& n, float freq, float amp,
+                              uint32_t& worst_bursts) {
+    std::vector<float> out;
+    if (action != Looper::NONE) {
+        looper.Request(action);
+    }
+    for (long b = 0; b < blocks; b++) {
+        float io[BLOCK_SIZE];
+        for (size_t i = 0; i < BLOCK_SIZE; i++, n++) {
+            io[i] = sine(n, freq, amp);
+        }
+        looper.ResetTraffic();
+        looper.Process(io, BLOCK_SIZE);
+        if (looper.GetTraffic().bursts > worst_bursts) {
+            worst_bursts = looper.GetTraffic().bursts;
+        }
+        out.insert(out.end(), io, io + BLOCK_SIZE);
+    }
+    return out;
+}
+
+static float max_error(const std::vector<float>& a, const std::vector<float>& b, size_t from, size_t to) {
+    float e = 0.0f;
+    for (size_t i = from; i < to; i++) {
+        e = fmaxf(e, fabsf(a[i] - b[i]));
+    }
+    return e;
+}
+
+static void gestures(float* mem) {
+    printf("gestures:\n");
+    looper.Init(SAMPLE_RATE, mem, LOOPER_MEM_SIZE);
+    const long loop_blocks = 375;               // 2 s
+    const size_t L = loop_blocks * BLOCK_SIZE;
+    uint32_t worst_bursts = 0;
+    long n = 0;
+
+    // Record A, the live signal passes through untouched
+    const long a_start = n;
+    std::vector<float> out = run(Looper::TAP, loop_blocks, n, 220.0f, 0.5f, worst_bursts);
+    std::vector<float> a(L);
+    for (size_t i = 0; i < L; i++) {
+        a[i] = sine(a_start + i, 220.0f, 0.5f);
+    }
+    check(looper.GetState() == Looper::RECORDING && max_error(out, a, 0, L) == 0.0f, "record: dry passes through");
+
+    // Close while A goes on for a block (the seam), then silence
+    const long tail_start = n;
+    run(Looper::TAP, 1, n, 220.0f, 0.5f, worst_bursts);
+    run(Looper::NONE, loop_blocks - 1, n, 0.0f, 0.0f, worst_bursts);
+    check(looper.GetState() == Looper::PLAYING, "tap: close the loop and play");
+
+    // What the loop should hold: A faded in, crossfaded with A's tail at the start
+    std::vector<float> loop(a);
+    for (size_t i = 0; i < BLOCK_SIZE; i++) {
+        const float r = (float)(i + 1) / BLOCK_SIZE;
+        loop[i] = a[i] * r + sine(tail_start + i, 220.0f, 0.5f) * (1.0f - r);
+    }
+    out = run(Looper::NONE, loop_blocks, n, 0.0f, 0.0f, worst_bursts);
+    check(max_error(out, loop, 0, L) < MATCH_TOLERANCE, "play: loop matches, seam crossfaded");
+
+    // Overdub B for one pass, then play
+    std::vector<float> dub = run(Looper::TAP, loop_blocks, n, 330.0f, 0.3f, worst_bursts);
+    check(looper.GetState() == Looper::OVERDUBBING, "tap: overdub");
+    const long b_start = n - L;
+    std::vector<float> b(L);
+    for (size_t i = 0; i < L; i++) {
+        b[i] = sine(b_start + i, 330.0f, 0.3f);
+    }
+    std::vector<float> heard(L);
+    for (size_t i = 0; i < L; i++) {
+        heard[i] = b[i] + loop[i];
+    }
+    check(max_error(dub, heard, 0, L) < MATCH_TOLERANCE, "overdub: hears the loop under the live signal");
+    run(Looper::TAP, 0, n, 0.0f, 0.0f, worst_bursts);
+    out = run(Looper::NONE, loop_blocks, n, 0.0f, 0.0f, worst_bursts);
+    check(looper.GetState() == Looper::PLAYING, "tap: back to play");
+    std::vector<float> both(loop);
+    for (size_t i = 0; i < L; i++) {
+        const float r = i < BLOCK_SIZE ? (float)(i + 1) / BLOCK_SIZE : 1.0f;
+        both[i] += r * b[i];
+    }
+    check(max_error(out, both, 0, L) < MATCH_TOLERANCE, "play: loop holds the overdub");
+
+    // Stop fades out within a block, then silence
+    out = run(Looper::STOP, 4, n, 0.0f, 0.0f, worst_bursts);
+    check(looper.GetState() == Looper::STOPPED && max_error(out, std::vector<float>(out.size()), BLOCK_SIZE, out.size()) == 0.0f,
+          "stop: fades out");
+
+    // Play starts from the top
+    out = run(Looper::TAP, 2, n, 0.0f, 0.0f, worst_bursts);
+    check(max_error(out, both, BLOCK_SIZE, 2 * BLOCK_SIZE) < MATCH_TOLERANCE, "tap: play from the start");
+
+    // Stop when stopped clears
+    run(Looper::STOP, 2, n, 0.0f, 0.0f, worst_bursts);
+    run(Looper::STOP, 1, n, 0.0f, 0.0f, worst_bursts);
+    check(looper.GetState() == Looper::EMPTY, "stop when stopped: clear");
+
+    // Too short to be a loop
+    run(Looper::TAP, 10, n, 220.0f, 0.5f, worst_bursts);
+    run(Looper::TAP, 1, n, 220.0f, 0.5f, worst_bursts);
+    check(looper.GetState() == Looper::EMPTY, "record under LOOPER_MIN_SECONDS: dropped");
+
+    // A recording that runs out of memory becomes the loop
+    looper.Init(SAMPLE_RATE, mem, 48000);
+    run(Looper::TAP, 200, n, 220.0f, 0.5f, worst_bursts);
+    check(looper.GetState() == Looper::PLAYING, "record to the end of the buffer: loop it");
+
+    check(worst_bursts <= 4, "at most four bursts per block");
+}
+
+static void usage() {
+    fprintf(stderr, "usage: looper_bench [-s seconds]\n");
+}
+
+int main(int argc, char** argv) {
+    float seconds = 60.0f;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        switch (opt) {
+            case 's': seconds = (float)atof(optarg); break;
+            default: usage(); return 2;
+        }
+    }
+    if (seconds < 10.0f) {
+        usage();
+        return 2;
+    }
+
+    float* looper_mem = (float*)malloc(LOOPER_MEM_SIZE * sizeof(float));
+    if (!looper_mem) {
+        fprintf(stderr, "no memory for the loop\n");
+        return 1;
+    }
+    // Touch every page up front, the SDRAM has no page faults to time
+    memset(looper_mem, 0, LOOPER_MEM_SIZE * sizeof(float));
+    gestures(looper_mem);
+
+    // The looper in the chain: record 8 s, play, overdub, play, stop, play...
+    setupWeights();
+    engine.Init(SAMPLE_RATE, reverb_mem, delay_mem, looper_mem, &engine_weights);
+    engine.LoadModel(model_collection[0]);
+    engine.LoadIR(ir_collection[0]);
+    engine.ToggleBypass();
+
+    EngineControls ctl;
+    ctl.gain = 1.0f;
+    ctl.mix = 0.3f;
+    ctl.level = 1.0f;
+    ctl.filter = 0.5f;
+    ctl.reverb_time = 0.5f;
+    ctl.reverb_decay = 0.5f;
+    ctl.cond[0] = ctl.cond[1] = 0.5f;
+
+    static const Looper::Action script[] = { Looper::TAP, Looper::TAP, Looper::TAP, Looper::TAP, Looper::STOP, Looper::TAP };
+    const int script_len = sizeof(script) / sizeof(script[0]);
+    const float period = BLOCK_SIZE / SAMPLE_RATE;
+    const long blocks = (long)(seconds / period);
+    const long step_blocks = (long)(8.0f / period);
+    float in[BLOCK_SIZE], outL[BLOCK_SIZE], outR[BLOCK_SIZE];
+    uint64_t bytes = 0;
+    uint32_t worst_bursts = 0;
+    std::vector<float> block_times;
+    float total_sdram = 0.0f;
+    float phase = 0.0f;
+
+    for (long b = 0; b < blocks; b++) {
+        if (b % step_blocks == 0) {
+            engine.LooperRequest(script[(b / step_blocks) % script_len]);
+        }
+        for (size_t i = 0; i < BLOCK_SIZE; i++) {
+            phase += 2.0f * (float)M_PI * 110.0f / SAMPLE_RATE;
+            if (phase > 2.0f * (float)M_PI) phase -= 2.0f * (float)M_PI;
+            in[i] = 0.4f * sinf(phase);
+        }
+        const Looper::Traffic before = engine.LooperTraffic();
+        engine.Process(in, outL, outR, BLOCK_SIZE, ctl);
+        const uint32_t bursts = engine.LooperTraffic().bursts - before.bursts;
+        const uint32_t block_bytes = engine.LooperTraffic().bytes - before.bytes;
+
+        // Measured on the host plus the SDRAM stand-in
+        const float sdram = (bursts * SDRAM_BURST_NS + block_bytes / 4 * SDRAM_NS_PER_WORD) * 1e-9f;
+        const float t = engine.LooperMeter().Last() / CycleMeter::TicksPerSecond() + sdram;
+        block_times.push_back(t);
+        total_sdram += sdram;
+        worst_bursts = bursts > worst_bursts ? bursts : worst_bursts;
+        bytes += block_bytes;
+    }
+
+    const float tps = CycleMeter::TicksPerSecond();
+    const float bandwidth = bytes / seconds;
+    printf("chain:           %.0f s, %ld blocks, loop of %.0f s max\n", seconds, blocks, LOOPER_MEM_SIZE / SAMPLE_RATE);
+    printf("amp model:       mean %.1f us, peak %.1f us per block\n", 1e6f * engine.AmpMeter().Average() / tps,
+           1e6f * engine.AmpMeter().Peak() / tps);
+    printf("looper:          mean %.1f us, peak %.1f us per block measured\n",
+           1e6f * engine.LooperMeter().Average() / tps, 1e6f * engine.LooperMeter().Peak() / tps);
+    printf("SDRAM stand-in:  mean %.1f us per block, %u bursts at most\n", 1e6f * total_sdram / blocks, worst_bursts);
+    printf("SDRAM bandwidth: %.0f KB/s, %.2f%% of the stand-in's\n", bandwidth / 1024.0f,
+           100.0f * bandwidth * SDRAM_NS_PER_WORD * 1e-9f / 4.0f);
+    std::sort(block_times.begin(), block_times.end());
+    const float worst_block = block_times[block_times.size() - 1 - block_times.size() / 1000];
+    printf("99.9%% block:     %.1f us, %.2f%% of the period (budget %.0f%%)\n", 1e6f * worst_block,
+           100.0f * worst_block / period, 100.0f * LOOPER_BUDGET);
+
+    if (worst_bursts > 4) {
+        printf("FAIL: more than four bursts in a block\n");
+        ok = false;
+    }
+    if (worst_block > LOOPER_BUDGET * period) {
+        printf("FAIL: the looper is over its budget\n");
+        ok = false;
+    }
+    free(looper_mem);
+    if (ok) {
+        printf("OK\n");
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+# Per-object memory map of the firmware (make memmap)
+#   Input: `nm -S --size-sort` of the elf. Prints every object with its memory
+#   region and flags hot objects (HOT, space separated symbol names) that ended
+#   up outside tightly-coupled/internal RAM.
+#
+#   awk -v HOT="engine engine_weights" -v MIN=256 -f host/memmap.awk
+
+# Portable hex parse (mawk has no strtonum)
+function hex(s,    i, v) {
+    v = 0
+    s = tolower(s)
+    for (i = 1; i <= length(s); i++)
+        v = v * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+    return v
+}
+
+function region(addr) {
+    if (addr < hex("00010000")) return "ITCM"
+    if (addr >= hex("08000000") && addr < hex("08200000")) return "FLASH"
+    if (addr >= hex("20000000") && addr < hex("20020000")) return "DTCM"
+    if (addr >= hex("24000000") && addr < hex("24080000")) return "AXI_SRAM"
+    if (addr >= hex("30000000") && addr < hex("30048000")) return "SRAM1-3"
+    if (addr >= hex("38000000") && addr < hex("38010000")) return "SRAM4"
+    if (addr >= hex("90000000") && addr < hex("A0000000")) return "QSPI"
+    if (addr >= hex("C0000000") && addr < hex("C4000000")) return "SDRAM"
+    return "OTHER"
+}
+
+# Fast enough for per-sample access from the audio callback
+function fast(r) {
+    return r == "ITCM" || r == "DTCM" || r == "AXI_SRAM"
+}
+
+BEGIN {
+    if (MIN == "") MIN = 256
+    n = split(HOT, hot_list, " ")
+    for (i = 1; i <= n; i++) hot[hot_list[i]] = 1
+    printf "%-10s %10s  %s\n", "REGION", "BYTES", "OBJECT"
+}
+
+# addr size type name
+NF >= 4 && $3 ~ /^[bBdDrR]$/ {
+    addr = hex($1)
+    size = hex($2)
+    r = region(addr)
+    total[r] += size
+    flag = ""
+    if ($4 in hot) {
+        seen[$4] = 1
+        flag = fast(r) ? "  hot" : "  HOT IN SLOW MEMORY"
+        if (!fast(r)) bad++
+    }
+    if (size >= MIN || flag != "")
+        printf "%-10s %10d  %s%s\n", r, size, $4, flag
+}
+
+END {
+    print ""
+    for (r in total) printf "%-10s %10d  total\n", r, total[r]
+    for (h in hot) {
+        if (!(h in seen)) {
+            printf "warning: hot object %s not found\n", h
+        }
+    }
+    print "note: std::vector assets (model_collection, ir_collection, conditioning bias) are heap, in AXI_SRAM"
+    if (bad > 0) {
+        printf "%d hot object(s) in slow memory\n", bad
+        exit 1
+    }
+}
@@ -0,0 +1,480 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Real-time safety checker (host build, `make rt-check`)
+//   Runs the engine's block processing under interposed malloc/free/operator new
+//   and pthread mutex hooks. Any allocation or lock while "in callback" is a
+//   violation. Control changes are fuzzed the way the pedal produces them:
+//   knob sweeps and bypass toggles reach the callback, switch flips (model and
+//   IR loads, delay modes), tempo taps, looper gestures and IR blend kernels are
+//   computed in the control context, like the main loop.
+//   By default the control context runs between blocks. With -i the blocks
+//   interrupt it instead, the way the audio callback interrupts the main loop on
+//   the pedal: a one-shot timer signal runs each block at a random point of the
+//   control round, so model and IR loads, eco cab changes and blend kernels are
+//   caught halfway through by the block that picks them up. One block per round
+//   still; when the round is over before the timer, the block runs right after.
+//   Fails (exit 1) on any allocation or lock in the callback, or on a non-finite
+//   output sample (a torn model or kernel handoff tends to show up as one).
+//   Also records the block time, and the delay's and looper's cost next to the
+//   model's. Those are host timings, not the Daisy's (another CPU, and the host
+//   preempts us now and then), so they are printed as advisory and never fail
+//   the run; the pedal's budget is enforced on the pedal by measure_costs() and
+//   the load governor (`make governor-sim`).
+//
+//   usage: rt_check [-i] [blocks] [seed] [io_rate]   (io_rate 96000: half-band multi-rate path)
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <new>
+#include <random>
+
+#include "altair_engine.h"
+#include "tuner.h"
+#include "all_model_data_gru9_4count.h"
+#include "ImpulseResponse/IrMorph.h"
+#include "ImpulseResponse/ir_data.h"
+#include "ImpulseResponse/ir_eco_data.h"
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+#define MAX_TRACE_DEPTH 32
+
+static thread_local bool in_callback = false;
+
+static int violation_count = 0;
+static const char* first_violation = nullptr;
+static void* first_trace[MAX_TRACE_DEPTH];
+static int first_trace_depth = 0;
+
+typedef int (*mutex_fn)(pthread_mutex_t*);
+static mutex_fn real_mutex_lock = nullptr;
+static mutex_fn real_mutex_trylock = nullptr;
+
+// Must not allocate: only static storage, the backtrace machinery is warmed up in main()
+static void violation(const char* what) {
+    in_callback = false;
+    if (violation_count++ == 0) {
+        first_violation = what;
+        first_trace_depth = backtrace(first_trace, MAX_TRACE_DEPTH);
+    }
+    in_callback = true;
+}
+
+extern "C" void* malloc(size_t size) {
+    if (in_callback) violation("malloc");
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size) {
+    if (in_callback) violation("calloc");
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+    if (in_callback) violation("realloc");
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" int posix_memalign(void** ptr, size_t alignment, size_t size) {
+    if (in_callback) violation("posix_memalign");
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr ? 0 : ENOMEM;
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size) {
+    if (in_callback) violation("aligned_alloc");
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void free(void* ptr) {
+    if (in_callback && ptr) violation("free");
+    __libc_free(ptr);
+}
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t* m) {
+    if (in_callback) violation("pthread_mutex_lock");
+    return real_mutex_lock(m);
+}
+
+extern "C" int pthread_mutex_trylock(pthread_mutex_t* m) {
+    if (in_callback) violation("pthread_mutex_trylock");
+    return real_mutex_trylock(m);
+}
+
+void* operator new(size_t size) {
+    if (in_callback) violation("operator new");
+    void* p = __libc_malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    if (in_callback) violation("operator new[]");
+    void* p = __libc_malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (in_callback && ptr) violation("operator delete");
+    __libc_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    if (in_callback && ptr) violation("operator delete[]");
+    __libc_free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    operator delete[](ptr);
+}
+
+#define BLOCK_SIZE 256
+
+static float reverb_mem[REVERB_MEM_SIZE];   // ~340 KB, lives in SDRAM on the pedal
+static float delay_mem[DELAY_MEM_SIZE];
+static float looper_mem[LOOPER_MEM_SIZE];   // ~46 MB, same
+static AltairEngine engine;
+static EngineWeights engine_weights;
+static IrMorph ir_morph;
+static float ir_kernel[IR_MAX_LENGTH];
+static float ir_kernel_right[IR_MAX_LENGTH];
+static TunerRing tuner_ring;
+static TunerFeed tuner_feed;
+static Tuner tuner;
+
+// A knob that mostly sweeps slowly and sometimes jumps, like a hand on the pedal
+struct FuzzKnob {
+    float value = 0.5f;
+    float target = 0.5f;
+
+    float Next(std::mt19937& rng) {
+        std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+        if (uni(rng) < 0.01f) {
+            target = uni(rng);
+        }
+        if (uni(rng) < 0.001f) {
+            value = target;     // jump
+        }
+        value += (target - value) * 0.05f;
+        return value;
+    }
+};
+
+// Control context: one round of switch, footswitch and knob-to-kernel events
+struct Control {
+    std::mt19937 rng;
+    float sample_rate;
+    long model_loads = 0, lite_loads = 0, ir_loads = 0, ir_blends = 0, delay_changes = 0, cab_toggles = 0,
+         looper_gestures = 0, tuner_readings = 0;
+    TapTempo tap_tempo;
+    uint32_t now_ms = 0;
+
+    // True if it loaded or computed something, rather than just flipping a flag
+    bool Run() {
+        std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+        bool work = false;
+        if (uni(rng) < 0.005f) {
+            // Half of the entries that have a lite model load it
+            const modelData& md = model_collection[rng() % model_collection.size()];
+            const bool lite = LiteAvailable(md) && (rng() & 1);
+            if (engine.LoadModel(md, lite)) {
+                model_loads++;
+                lite_loads += lite;
+            }
+            work = true;
+        }
+        if (uni(rng) < 0.005f) {
+            size_t a = rng() % ir_collection.size();
+            size_t b2 = (a + 1) % ir_collection.size();
+            // Every other load as a synthetic dual-mic pair, so the stereo kernels are exercised,
+            const std::vector<float>& right = (ir_loads & 1) ? ir_collection[b2] : ir_collection_right[a];
+            ir_morph.Prepare(ir_collection[a], ir_collection[b2], right, ir_collection_right[b2]);
+            // and some truncated, so kernels of another length go through the handoff
+            const size_t len = (ir_loads & 2) ? ir_morph.Length() / 2 + rng() % (ir_morph.Length() / 2)
+                                              : ir_morph.Length();
+            if (engine.SetIRKernel(ir_morph.KernelA(), ir_morph.KernelARight(), len)) {
+                ir_loads++;
+            }
+            engine.SetEcoCab(ir_eco_collection[a], &ir_eco_collection_right[a]);
+            work = true;
+        }
+        if (uni(rng) < 0.002f) {
+            engine.eco_cab_enabled = !engine.eco_cab_enabled;
+            cab_toggles++;
+        }
+        // Looper footswitches, stops now and then (twice in a row clears)
+        if (uni(rng) < 0.004f) {
+            engine.LooperRequest(uni(rng) < 0.7f ? Looper::TAP : Looper::STOP);
+            looper_gestures++;
+        }
+        // Tuner runs in the main loop while bypassed
+        if (engine.IsBypassed()) {
+            tuner_readings += tuner.Update() && tuner.Valid();
+        }
+
+        // Delay switch and tempo taps
+        if (uni(rng) < 0.005f) {
+            const float second[3] = {0.0f, 0.6666667f, 0.75f};
+            int d = rng() % 3;
+            engine.SetDelay(d != 0, second[d]);
+            delay_changes++;
+        }
+        now_ms += (uint32_t)(1000.0f * BLOCK_SIZE / sample_rate);
+        if (uni(rng) < 0.02f && tap_tempo.Tap(now_ms)) {
+            engine.SetDelayBeat(tap_tempo.BeatSeconds());
+        }
+
+        // IR blend knob, kernel swapped into the running convolver
+        if (uni(rng) < 0.05f) {
+            ir_morph.Blend(uni(rng), uni(rng) < 0.5f ? IrMorph::MORPH_TIME : IrMorph::MORPH_SPECTRAL,
+                           ir_kernel, ir_kernel_right);
+            ir_blends += engine.SetIRKernel(ir_kernel, ir_morph.IsStereo() ? ir_kernel_right : nullptr,
+                                            ir_morph.Length());
+            work = true;
+        }
+        return work;
+    }
+};
+
+// Audio context: one callback's worth, knobs and bypass reach it directly
+struct Audio {
+    std::mt19937 rng;
+    float sample_rate;
+    FuzzKnob knobs[6];
+    float in[BLOCK_SIZE];
+    float outL[BLOCK_SIZE];
+    float outR[BLOCK_SIZE];
+    float phase = 0.0f;
+    long bypass_toggles = 0, quality_changes = 0, non_finite = 0;
+    double total_us = 0.0, worst_us = 0.0;
+    long worst_block = 0, late = 0;
+
+    void Run(long b) {
+        std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+        for (size_t i = 0; i < BLOCK_SIZE; i++) {
+            phase += 2.0f * (float)M_PI * 110.0f / sample_rate;
+            if (phase > 2.0f * (float)M_PI) phase -= 2.0f * (float)M_PI;
+            in[i] = 0.4f * sinf(phase) + 0.05f * (uni(rng) - 0.5f);
+        }
+
+        EngineControls ctl;
+        ctl.gain = 0.1f + 2.4f * knobs[0].Next(rng);
+        ctl.mix = knobs[1].Next(rng);
+        ctl.level = knobs[2].Next(rng);
+        float f = knobs[3].Next(rng);
+        ctl.filter = f * f * f;
+        ctl.reverb_time = knobs[4].Next(rng);
+        ctl.reverb_decay = knobs[5].Next(rng);
+        ctl.cond[0] = knobs[0].value;
+        ctl.cond[1] = knobs[4].value;
+        bool toggle = uni(rng) < 0.002f;
+        // Governor steps, normally decided in the callback
+        bool step_quality = uni(rng) < 0.01f;
+        if (uni(rng) < 0.001f) {
+            engine.stereo_enabled = !engine.stereo_enabled;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        in_callback = true;
+        if (toggle) {
+            engine.ToggleBypass();
+        }
+        if (engine.IsBypassed()) {
+            tuner_feed.Process(in, BLOCK_SIZE);
+        }
+        if (step_quality) {
+            engine.SetQuality((QualityLevel)(rng() % QUALITY_COUNT));
+        }
+        engine.Process(in, outL, outR, BLOCK_SIZE, ctl);
+        in_callback = false;
+        auto end = std::chrono::steady_clock::now();
+
+        for (size_t i = 0; i < BLOCK_SIZE; i++) {
+            non_finite += !isfinite(outL[i]) || !isfinite(outR[i]);
+        }
+        bypass_toggles += toggle;
+        quality_changes += step_quality;
+        double us = std::chrono::duration<double, std::micro>(end - start).count();
+        total_us += us;
+        late += us > 1e6 * BLOCK_SIZE / sample_rate;
+        if (us > worst_us) {
+            worst_us = us;
+            worst_block = b;
+        }
+    }
+};
+
+// With -i the block runs from a timer signal, on top of the control round, like
+// the audio interrupt (nothing in it may allocate or lock anyway)
+static Audio audio;
+static volatile sig_atomic_t block_done = 0;
+static long block_index = 0;
+
+static void block_interrupt(int) {
+    audio.Run(block_index);
+    block_done = 1;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: rt_check [-i] [blocks] [seed] [io_rate]\n");
+}
+
+int main(int argc, char** argv) {
+    bool interrupt = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "i")) != -1) {
+        switch (opt) {
+            case 'i': interrupt = true; break;
+            default: usage(); return 2;
+        }
+    }
+    argc -= optind;
+    argv += optind;
+    long blocks = argc > 0 ? atol(argv[0]) : 200000;
+    unsigned seed = argc > 1 ? (unsigned)atol(argv[1]) : 1;
+    const float sample_rate = argc > 2 ? (float)atof(argv[2]) : 48000.0f;
+
+    real_mutex_lock = (mutex_fn)dlsym(RTLD_NEXT, "pthread_mutex_lock");
+    real_mutex_trylock = (mutex_fn)dlsym(RTLD_NEXT, "pthread_mutex_trylock");
+    void* warm[1];
+    backtrace(warm, 1);     // first call loads libgcc, which allocates
+
+    setupWeights();
+
+    // Synthetic 3-input conditioned model so the conditioning path is exercised too
+    modelData cond = model_collection[0];
+    cond.inputSize = 3;
+    for (int k = 1; k < 3; k++) {
+        cond.rec_weight_ih_l0.push_back(cond.rec_weight_ih_l0[0]);
+        for (float& w : cond.rec_weight_ih_l0[k]) {
+            w *= 0.5f * k;
+        }
+    }
+    model_collection.push_back(cond);
+
+    engine.Init(sample_rate, reverb_mem, delay_mem, looper_mem, &engine_weights);
+    tuner_feed.Init(sample_rate, &tuner_ring);
+    tuner.Init(tuner_feed.Rate(), &tuner_ring);
+    ir_morph.Prepare(ir_collection[0], ir_collection[1]);
+    engine.LoadIR(ir_morph.KernelA(), ir_morph.Length());
+    engine.LoadModel(model_collection[0]);
+    engine.ToggleBypass();
+
+    static Control control;
+    long work_rounds = 0, interrupted = 0;
+    control.rng.seed(seed);
+    control.sample_rate = sample_rate;
+    audio.rng.seed(seed + 1);
+    audio.sample_rate = sample_rate;
+
+    if (!interrupt) {
+        for (long b = 0; b < blocks; b++) {
+            control.Run();      // between blocks, like the main loop
+            audio.Run(b);
+        }
+    } else {
+        struct sigaction sa = {};
+        sa.sa_handler = block_interrupt;
+        sa.sa_flags = SA_RESTART;
+        sigaction(SIGALRM, &sa, nullptr);
+        std::mt19937 offset_rng(seed + 2);
+        std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+        double work_us = 50.0;      // how long a round with loads in it takes, roughly
+        for (long b = 0; b < blocks; b++) {
+            // A random point of a round that does some work
+            struct itimerval at = {};
+            at.it_value.tv_usec = 1 + (long)(uni(offset_rng) * work_us);
+            block_index = b;
+            block_done = 0;
+            setitimer(ITIMER_REAL, &at, nullptr);
+            auto start = std::chrono::steady_clock::now();
+            const bool work = control.Run();
+            auto end = std::chrono::steady_clock::now();
+            if (work) {
+                work_rounds++;
+                interrupted += block_done;
+                const double us = std::chrono::duration<double, std::micro>(end - start).count();
+                work_us += 0.05 * (us - work_us);
+            }
+            while (!block_done) {
+            }
+        }
+    }
+
+    double deadline_us = 1e6 * BLOCK_SIZE / sample_rate;
+    printf("blocks:          %ld (%.1f s of audio), seed %u, control %s\n", blocks, blocks * BLOCK_SIZE / sample_rate,
+           seed, interrupt ? "interrupted by the blocks" : "between blocks");
+    printf("control events:  %ld model loads (%ld lite), %ld IR loads, %ld IR blends, %ld bypass toggles,\n"
+           "                 %ld delay changes, %ld quality steps, %ld cab type toggles, %ld looper gestures\n",
+           control.model_loads, control.lite_loads, control.ir_loads, control.ir_blends, audio.bypass_toggles,
+           control.delay_changes, audio.quality_changes, control.cab_toggles, control.looper_gestures);
+    printf("tuner:           %ld readings while bypassed\n", control.tuner_readings);
+    if (interrupt) {
+        printf("interrupts:      %ld of %ld control rounds with loads or kernels in them cut by a block\n",
+               interrupted, work_rounds);
+    }
+    if (engine.IsMultirate()) {
+        printf("multi-rate:      %.0f Hz I/O, chain at %.0f Hz\n", sample_rate, engine.CoreSampleRate());
+    }
+    printf("host timing (advisory, not the Daisy's and not checked):\n");
+    printf("  block time:    mean %.1f us, worst %.1f us (block %ld), %ld over the %.1f us period\n",
+           audio.total_us / blocks, audio.worst_us, audio.worst_block, audio.late, deadline_us);
+    printf("  stage cost:    amp model %.2f%%, delay %.2f%%, looper %.2f%% of the block period\n",
+           100.0f * engine.AmpMeter().Load(BLOCK_SIZE, sample_rate),
+           100.0f * engine.DelayMeter().Load(BLOCK_SIZE, sample_rate),
+           100.0f * engine.LooperMeter().Load(BLOCK_SIZE, sample_rate));
+    printf("\n");
+
+    bool ok = true;
+    if (audio.non_finite > 0) {
+        printf("FAIL: %ld non-finite output samples\n", audio.non_finite);
+        ok = false;
+    }
+    if (violation_count > 0) {
+        printf("FAIL: %d allocation/lock calls in the callback, first: %s\n", violation_count, first_violation);
+        fflush(stdout);
+        backtrace_symbols_fd(first_trace, first_trace_depth, STDOUT_FILENO);
+        ok = false;
+    }
+    if (ok) {
+        printf("OK: no allocation or lock in the callback, output finite\n");
+    }
+    return ok ? 0 : 1;
+}
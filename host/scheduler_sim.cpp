@@ -0,0 +1,441 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Scheduler simulation (host build, `make scheduler-sim`)
+//   Runs scheduler.h the way the firmware's main loop does, on a simulated
+//   microsecond clock that starts just before the wrap. Work is charged in
+//   virtual time: the periodic tasks have fixed costs, the audio interrupt
+//   takes its share of every block and preempts whatever is running, and a
+//   long sliced job (a stand-in for the IR blend) costs `step` per Step().
+//   The control task turns a knob at random times, sometimes in bursts, and
+//   resubmits the job each time, like update_ir_blend(). The mock audio side
+//   refuses Publish() until it has taken the last result at a block boundary.
+//   A short second job is queued now and then from the stats task, and an IR
+//   change: the real IrMorph prepare, one FFT per step, whose Publish() queues
+//   a spectral blend of the new pair, as in the firmware.
+//   Fails (exit 1) if a task is ever later than one job slice plus one step
+//   plus the other tasks (stretched by the audio load), if a result is
+//   published out of order (older than the one before), if a knob turn takes
+//   longer than two passes of the job (plus the waits around them) to show up
+//   in a published result, if the last knob position isn't the one that
+//   ends up published, or if a job's Progress() isn't 0 after Begin(), rising
+//   with every Step() and 1 once the pass is done and at Publish().
+//
+//   usage: scheduler_sim [-s seconds] [-t slice_us] [-c step_us] [-n steps]
+//                        [-a audio_load]
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "ImpulseResponse/IrMorph.h"
+#include "scheduler.h"
+
+#define BLOCK_US 5333               // 256 samples at 48 kHz
+#define CONTROL_PERIOD_US 10000
+#define STATS_PERIOD_US 100000
+#define CONTROL_COST_US 300
+#define DISPLAY_COST_US 120
+#define STATS_COST_US 80
+#define STATS_STEP_US 250
+#define STATS_STEPS 4
+#define IR_STEP_US 300              // one FFT
+#define IR_PREPARE_STEPS 5          // stereo pair
+#define IR_BLEND_STEPS 6
+
+static uint32_t now_us = 0xFFFFFFFFu - 2000000;    // wraps two seconds in
+static uint32_t next_block;
+static uint32_t audio_cost;
+static uint32_t blocks;
+static bool kernel_pending;         // published, not taken by the audio side yet
+static int kernel_taken;            // knob position the audio side runs with
+
+static std::mt19937 rng(1);
+static Scheduler scheduler;
+
+static uint32_t sim_clock() {
+    return now_us;
+}
+
+static void audio_block() {
+    now_us += audio_cost;
+    next_block += BLOCK_US;
+    blocks++;
+    kernel_pending = false;     // like ApplyPending()
+}
+
+// Spend `us` of main loop time, the audio interrupt cuts in at each block
+static void advance(uint32_t us) {
+    while (true) {
+        const uint32_t to_block = next_block - now_us;
+        if (us < to_block) {
+            now_us += us;
+            return;
+        }
+        now_us += to_block;
+        us -= to_block;
+        audio_block();
+    }
+}
+
+// Sleep for `us` of wall time (DelayUs()), the interrupts still come
+static void sleep(uint32_t us) {
+    const uint32_t end = now_us + us;
+    while ((int32_t)(next_block - end) <= 0) {
+        now_us = next_block;
+        audio_block();
+    }
+    if ((int32_t)(end - now_us) > 0) {
+        now_us = end;
+    }
+}
+
+// Base of the simulated jobs, checks their progress around every call
+class CheckedJob : public SlicedJob {
+  public:
+    int progress_errors = 0;
+
+    void Begin() final {
+        DoBegin();
+        last = Progress();
+        progress_errors += last != 0.0f;
+    }
+    bool Step() final {
+        const bool done = DoStep();
+        const float p = Progress();
+        progress_errors += !(p > last) || (done ? p != 1.0f : p >= 1.0f);
+        last = p;
+        return done;
+    }
+    bool Publish() final {
+        progress_errors += Progress() != 1.0f;
+        return DoPublish();
+    }
+
+  protected:
+    virtual void DoBegin() = 0;
+    virtual bool DoStep() = 0;
+    virtual bool DoPublish() = 0;
+
+  private:
+    float last = 0.0f;
+};
+
+// The knob the blend job follows
+static int knob = 0;
+static int submits = 0;
+static uint32_t next_turn;
+static std::vector<uint32_t> turned_at(1, now_us);     // per knob position
+
+class SynthBlendJob : public CheckedJob {
+  public:
+    int steps = 60;
+    uint32_t step_us = 400;
+    int published = -1;
+    int out_of_order = 0;
+    int refused = 0;
+    int passes = 0;
+    int restarts = 0;               // a pass started over before it finished, never expected
+    uint32_t worst_lag_us = 0;      // knob turn to a result that includes it
+
+    float Progress() const override {
+        return (float)step / steps;
+    }
+
+  protected:
+    void DoBegin() override {
+        if (step < steps && step > 0) {
+            restarts++;
+        }
+        value = knob;
+        step = 0;
+        passes++;
+    }
+    bool DoStep() override {
+        advance(step_us);
+        return ++step == steps;
+    }
+    bool DoPublish() override {
+        if (kernel_pending) {
+            refused++;
+            return false;
+        }
+        if (value < published) {
+            out_of_order++;
+        }
+        for (int k = published + 1; k <= value; k++) {
+            if (now_us - turned_at[k] > worst_lag_us) {
+                worst_lag_us = now_us - turned_at[k];
+            }
+        }
+        published = value;
+        kernel_taken = value;
+        kernel_pending = true;
+        return true;
+    }
+  private:
+    int value = 0;
+    int step = 0;
+};
+
+class SynthStatsJob : public CheckedJob {
+  public:
+    int runs = 0;
+
+    float Progress() const override {
+        return (float)step / STATS_STEPS;
+    }
+
+  protected:
+    void DoBegin() override {
+        step = 0;
+    }
+    bool DoStep() override {
+        advance(STATS_STEP_US);
+        return ++step == STATS_STEPS;
+    }
+    bool DoPublish() override {
+        runs++;
+        return true;
+    }
+
+  private:
+    int step = 0;
+};
+
+// IR change on the real IrMorph, with synthetic IRs
+static IrMorph ir_morph;
+static std::vector<float> irs[2];
+static std::vector<float> irs_right[2];
+static float ir_kernel[IR_MAX_LENGTH];
+static float ir_kernel_right[IR_MAX_LENGTH];
+static const std::vector<float> mono;      // no right IR
+
+class IrBlendJob : public CheckedJob {
+  public:
+    int runs = 0;
+
+    float Progress() const override {
+        return ir_morph.BlendProgress();
+    }
+
+  protected:
+    void DoBegin() override {
+        ir_morph.BeginBlend(std::uniform_real_distribution<float>(0.0f, 1.0f)(rng), IrMorph::MORPH_SPECTRAL,
+                            ir_kernel, ir_kernel_right);
+    }
+    bool DoStep() override {
+        advance(IR_STEP_US);
+        return ir_morph.StepBlend();
+    }
+    bool DoPublish() override {
+        runs++;
+        return true;
+    }
+};
+
+class IrPrepareJob : public CheckedJob {
+  public:
+    int runs = 0;
+    IrBlendJob* blend = nullptr;
+
+    float Progress() const override {
+        return ir_morph.PrepareProgress();
+    }
+
+  protected:
+    void DoBegin() override {
+        // every other one a dual-mic pair
+        const int a = runs & 1;
+        ir_morph.BeginPrepare(irs[a], irs[a ^ 1], runs & 2 ? irs_right[a] : mono, runs & 2 ? irs_right[a ^ 1] : mono);
+    }
+    bool DoStep() override {
+        advance(IR_STEP_US);
+        return ir_morph.StepPrepare();
+    }
+    bool DoPublish() override {
+        runs++;
+        return scheduler.Submit(blend);
+    }
+};
+
+static SynthBlendJob blend_job;
+static SynthStatsJob stats_job;
+static IrBlendJob ir_blend_job;
+static IrPrepareJob ir_prepare_job;
+
+static void control_task() {
+    advance(CONTROL_COST_US);
+    if ((int32_t)(now_us - next_turn) >= 0) {
+        knob++;
+        turned_at.push_back(now_us);
+        submits++;
+        scheduler.Submit(&blend_job);
+        // mostly a turn now and then, sometimes a sweep (every control tick)
+        std::uniform_int_distribution<uint32_t> gap(0, 9);
+        next_turn = now_us + (gap(rng) < 3 ? CONTROL_PERIOD_US
+                                           : std::uniform_int_distribution<uint32_t>(20000, 200000)(rng));
+    }
+}
+
+static void display_task() {
+    advance(DISPLAY_COST_US);
+}
+
+static void stats_task() {
+    advance(STATS_COST_US);
+    if (std::uniform_int_distribution<int>(0, 4)(rng) == 0) {
+        scheduler.Submit(&stats_job);
+    }
+    if (std::uniform_int_distribution<int>(0, 9)(rng) == 0) {
+        scheduler.Submit(&ir_prepare_job);     // switch 1 flipped
+    }
+}
+
+static void usage() {
+    fprintf(stderr, "usage: scheduler_sim [-s seconds] [-t slice_us] [-c step_us] [-n steps]\n"
+                    "                     [-a audio_load]\n");
+}
+
+int main(int argc, char** argv) {
+    float seconds = 30.0f;
+    uint32_t slice_us = 2000;
+    float audio_load = 0.6f;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:t:c:n:a:")) != -1) {
+        switch (opt) {
+            case 's': seconds = atof(optarg); break;
+            case 't': slice_us = atoi(optarg); break;
+            case 'c': blend_job.step_us = atoi(optarg); break;
+            case 'n': blend_job.steps = atoi(optarg); break;
+            case 'a': audio_load = atof(optarg); break;
+            default: usage(); return 2;
+        }
+    }
+    if (seconds < 2.0f || audio_load < 0.0f || audio_load >= 0.95f || blend_job.steps < 1) {
+        usage();
+        return 2;
+    }
+    audio_cost = (uint32_t)(audio_load * BLOCK_US);
+    next_block = now_us + BLOCK_US;
+    next_turn = now_us + 50000;
+
+    // Two decaying noise IRs, the right ones a touch later (dual mic)
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    for (int k = 0; k < 2; k++) {
+        for (int i = 0; i < 700 + 300 * k; i++) {
+            irs[k].push_back(noise(rng) * expf(-i / (80.0f + 60.0f * k)));
+            irs_right[k].push_back(i < 3 ? 0.0f : 0.8f * irs[k][i - 3]);
+        }
+    }
+    ir_prepare_job.blend = &ir_blend_job;
+
+    scheduler.Init(sim_clock, slice_us);
+    scheduler.AddPeriodic("controls", control_task, CONTROL_PERIOD_US);
+    scheduler.AddPeriodic("display", display_task, CONTROL_PERIOD_US);
+    scheduler.AddPeriodic("stats", stats_task, STATS_PERIOD_US);
+    scheduler.Submit(&blend_job);
+    submits++;
+
+    // Lateness: a due task waits for at most the rest of the job slice, the
+    // longest Step() and the other tasks, all stretched by the audio interrupt
+    const uint32_t longest_step = std::max<uint32_t>(blend_job.step_us, std::max(STATS_STEP_US, IR_STEP_US));
+    const uint32_t work = slice_us + longest_step + CONTROL_COST_US + DISPLAY_COST_US + STATS_COST_US;
+    const uint32_t bound = (uint32_t)(work / (1.0f - audio_load)) + audio_cost;
+
+    // Lag: the pass running when the knob turns finishes, then one more with the
+    // new position; each may wait behind the stats job and an IR change, and for a block and a
+    // control period to publish. The jobs get the main loop's share of the time
+    // that the audio interrupt and the periodic tasks leave.
+    const float task_share = (CONTROL_COST_US + DISPLAY_COST_US) / (float)CONTROL_PERIOD_US
+                             + STATS_COST_US / (float)STATS_PERIOD_US;
+    const float job_share = 1.0f - audio_load - task_share;
+    const uint32_t pass = blend_job.steps * blend_job.step_us + STATS_STEPS * STATS_STEP_US
+                          + (IR_PREPARE_STEPS + IR_BLEND_STEPS) * IR_STEP_US;
+    const uint32_t lag_bound = (uint32_t)(2 * pass / job_share) + 2 * (BLOCK_US + CONTROL_PERIOD_US) + bound;
+
+    // Knob turns stop a second (or the lag bound) before the end so the last one
+    // can land
+    const uint32_t start = now_us;
+    const uint32_t total = (uint32_t)(seconds * 1e6f);
+    const uint32_t tail = lag_bound > 1000000 ? lag_bound : 1000000;
+    if (tail >= total) {
+        fprintf(stderr, "scheduler_sim: the job needs more than %.1f s of simulation\n", tail * 1e-6f);
+        return 2;
+    }
+    const uint32_t quiet = total - tail;
+    while (now_us - start < total) {
+        if (now_us - start >= quiet) {
+            next_turn = now_us + total;
+        }
+        scheduler.Poll();
+        sleep(scheduler.IdleUs());
+    }
+
+    printf("%.0f s simulated, %u audio blocks, audio load %.0f%%, slice %u us, job %d x %u us\n",
+           seconds, blocks, audio_load * 100.0f, slice_us, blend_job.steps, blend_job.step_us);
+    bool ok = true;
+    for (int i = 0; i < scheduler.TaskCount(); i++) {
+        const Scheduler::TaskStats& s = scheduler.Stats(i);
+        const bool late = s.worst_late_us > bound;
+        printf("  %-9s %6u runs, worst late %5u us, worst run %5u us%s\n", s.name, s.runs,
+               s.worst_late_us, s.worst_run_us, late ? "  TOO LATE" : "");
+        ok &= !late;
+    }
+    printf("  blend job: %d submits, %d passes, %u published, %d refused (audio busy), %d out of order\n",
+           submits, blend_job.passes, scheduler.Published() - stats_job.runs - ir_prepare_job.runs - ir_blend_job.runs,
+           blend_job.refused,
+           blend_job.out_of_order);
+    printf("  knob turn to published: worst %u us (bound %u us)\n", blend_job.worst_lag_us, lag_bound);
+    printf("  stats job: %d runs, IR changes: %d prepares, %d blends\n", stats_job.runs, ir_prepare_job.runs,
+           ir_blend_job.runs);
+    const int progress_errors = blend_job.progress_errors + stats_job.progress_errors
+                                + ir_prepare_job.progress_errors + ir_blend_job.progress_errors;
+    printf("  knob %d, published %d, audio side %d\n", knob, blend_job.published, kernel_taken);
+    printf("  lateness bound %u us\n", bound);
+
+    if (blend_job.out_of_order > 0 || blend_job.restarts > 0) {
+        printf("FAIL: results published out of order, or a pass thrown away\n");
+        ok = false;
+    }
+    if (blend_job.worst_lag_us > lag_bound) {
+        printf("FAIL: a knob turn took too long to be published\n");
+        ok = false;
+    }
+    if (blend_job.published != knob || kernel_taken != knob) {
+        printf("FAIL: the last knob position wasn't published\n");
+        ok = false;
+    }
+    if (progress_errors > 0) {
+        printf("FAIL: %d times a job's progress didn't start at 0, rise with each step or end at 1\n",
+               progress_errors);
+        ok = false;
+    }
+    if (scheduler.Current() != nullptr) {
+        printf("FAIL: jobs left in the queue\n");
+        ok = false;
+    }
+    if (ok) {
+        printf("OK\n");
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,537 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Lite model distiller (host build, `make wh-distill`)
+//   Renders every snapshot model in model_collection on synthetic guitar-like
+//   test signals (plucked strings and chords over the Gain knob's range, noise
+//   bursts, a sweep) and fits the Wiener-Hammerstein model of wh_lite.h to the
+//   amp output (GRU plus the engine's skip path):
+//     pre:   2nd order highpass + peaking biquad
+//     shape: cubic B-spline over the pre-filter's output range
+//     post:  2nd order lowpass + 2 peaking biquads
+//   The shaper is linear in its coefficients, so for any set of filters it's
+//   solved exactly by least squares (variable projection); Levenberg-Marquardt
+//   only moves the filters' frequency, Q and gain.
+//   The result is sampled into the runtime table and checked with the real
+//   float runtime on held-out plucks. Reported as ESR (error-to-signal ratio
+//   of the amp output, skip path included, lower is better), which is also
+//   stored with the data. Writes wh_lite_data.h, with a table only for the
+//   models whose lite model is good enough to fall back to (the rest would sit
+//   in flash unused); whether a model entry uses it is declared in the model
+//   data file (ModelN.lite / ModelN.run).
+//
+//   usage: wh_distill [-o output.h]
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "model_registry.h"
+#include "all_model_data_gru9_4count.h"
+
+#define SAMPLE_RATE 48000.0
+#define TRAIN_SECONDS 2.0
+#define CHECK_SECONDS 1.0
+#define SPLINE_SPANS 24
+#define SHAPE_SMOOTHING 1e-4        // second difference penalty, relative to the data
+#define LM_ITERATIONS 40
+#define LM_TOLERANCE 1e-4           // relative improvement per iteration that counts as converged
+#define INPUT_PEAK 1.2              // hottest amp input: Gain at 2.5 on a hot pickup
+#define ESR_CLOSE 0.02             // hard to tell apart
+#define ESR_FALLBACK 0.1            // fine when the GRU doesn't fit (RUN_AUTO)
+
+enum SectionType { SEC_HIGHPASS, SEC_LOWPASS, SEC_PEAK };
+
+// One biquad, the fitted parameters are log(f), gain dB, log(Q)
+struct Section {
+    SectionType type;
+    double logf, gain, logq;
+};
+
+struct Coefs {
+    double b0, b1, b2, a1, a2;
+};
+
+// RBJ cookbook
+static Coefs design(const Section& s) {
+    const double f = exp(s.logf), q = exp(s.logq);
+    const double w = 2.0 * M_PI * f / SAMPLE_RATE;
+    const double cw = cos(w), alpha = sin(w) / (2.0 * q);
+    double b0, b1, b2, a0, a1, a2;
+    if (s.type == SEC_HIGHPASS) {
+        b0 = (1.0 + cw) / 2.0; b1 = -(1.0 + cw); b2 = b0;
+        a0 = 1.0 + alpha; a1 = -2.0 * cw; a2 = 1.0 - alpha;
+    } else if (s.type == SEC_LOWPASS) {
+        b0 = (1.0 - cw) / 2.0; b1 = 1.0 - cw; b2 = b0;
+        a0 = 1.0 + alpha; a1 = -2.0 * cw; a2 = 1.0 - alpha;
+    } else {
+        const double A = pow(10.0, s.gain / 40.0);
+        b0 = 1.0 + alpha * A; b1 = -2.0 * cw; b2 = 1.0 - alpha * A;
+        a0 = 1.0 + alpha / A; a1 = -2.0 * cw; a2 = 1.0 - alpha / A;
+    }
+    return { b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0 };
+}
+
+static void filter(const Coefs& c, std::vector<double>& x) {
+    double z0 = 0.0, z1 = 0.0;
+    for (double& v : x) {
+        const double y = c.b0 * v + z0;
+        z0 = c.b1 * v - c.a1 * y + z1;
+        z1 = c.b2 * v - c.a2 * y;
+        v = y;
+    }
+}
+
+// Uniform cubic B-spline over -range..range, clamped outside like the table:
+// the 4 basis functions that are non-zero at u and the first one's index
+static int spline_weights(double u, double range, double w[4]) {
+    double t = (std::min(std::max(u, -range), range) + range) / (2.0 * range) * SPLINE_SPANS;
+    int i = std::min((int)t, SPLINE_SPANS - 1);
+    const double f = t - i;
+    w[0] = (1.0 - f) * (1.0 - f) * (1.0 - f) / 6.0;
+    w[1] = (3.0 * f * f * f - 6.0 * f * f + 4.0) / 6.0;
+    w[2] = (-3.0 * f * f * f + 3.0 * f * f + 3.0 * f + 1.0) / 6.0;
+    w[3] = f * f * f / 6.0;
+    return i;
+}
+
+// Solve A x = b in place, n small (Gaussian elimination, partial pivoting)
+static bool solve(std::vector<double>& A, std::vector<double>& b, size_t n) {
+    for (size_t c = 0; c < n; c++) {
+        size_t piv = c;
+        for (size_t r = c + 1; r < n; r++) {
+            if (fabs(A[r * n + c]) > fabs(A[piv * n + c])) piv = r;
+        }
+        if (fabs(A[piv * n + c]) < 1e-18) return false;
+        if (piv != c) {
+            for (size_t j = 0; j < n; j++) std::swap(A[c * n + j], A[piv * n + j]);
+            std::swap(b[c], b[piv]);
+        }
+        for (size_t r = c + 1; r < n; r++) {
+            const double m = A[r * n + c] / A[c * n + c];
+            for (size_t j = c; j < n; j++) A[r * n + j] -= m * A[c * n + j];
+            b[r] -= m * b[c];
+        }
+    }
+    for (size_t c = n; c-- > 0;) {
+        for (size_t j = c + 1; j < n; j++) b[c] -= A[c * n + j] * b[j];
+        b[c] /= A[c * n + c];
+    }
+    return true;
+}
+
+struct WhFit {
+    Section pre[WH_PRE_SECTIONS];
+    Section post[WH_POST_SECTIONS];
+    double range = 1.0;
+    std::vector<double> shape;      // SPLINE_SPANS + 3 spline coefficients
+    std::vector<double> basis;      // Solve()'s work buffer
+
+    // Parameter vector: per section log(f), log(Q), and the gain of peaks
+    std::vector<double> Params() const {
+        std::vector<double> p;
+        for (const Section* s : Sections()) {
+            p.push_back(s->logf);
+            p.push_back(s->logq);
+            if (s->type == SEC_PEAK) p.push_back(s->gain);
+        }
+        return p;
+    }
+
+    void SetParams(const std::vector<double>& p) {
+        size_t i = 0;
+        for (Section* s : Sections()) {
+            s->logf = std::min(std::max(p[i++], log(20.0)), log(0.45 * SAMPLE_RATE));
+            s->logq = std::min(std::max(p[i++], log(0.3)), log(s->type == SEC_PEAK ? 6.0 : 2.0));
+            if (s->type == SEC_PEAK) s->gain = std::min(std::max(p[i++], -24.0), 24.0);
+        }
+    }
+
+    std::vector<Section*> Sections() {
+        std::vector<Section*> v;
+        for (Section& s : pre) v.push_back(&s);
+        for (Section& s : post) v.push_back(&s);
+        return v;
+    }
+
+    std::vector<const Section*> Sections() const {
+        std::vector<const Section*> v;
+        for (const Section& s : pre) v.push_back(&s);
+        for (const Section& s : post) v.push_back(&s);
+        return v;
+    }
+
+    std::vector<double> PreFilter(const std::vector<double>& x) const {
+        std::vector<double> u = x;
+        for (const Section& s : pre) filter(design(s), u);
+        return u;
+    }
+
+    // Solve the shaper for the current filters against target y; returns the
+    // residual
+    std::vector<double> Solve(const std::vector<double>& x, const std::vector<double>& y) {
+        const std::vector<double> u = PreFilter(x);
+        range = 0.0;
+        for (double v : u) range = std::max(range, fabs(v));
+        range = std::max(range * 1.05, 1e-3);
+
+        // Every basis function's contribution after the post-filter, sample
+        // major so the post-filter runs all of them side by side
+        const size_t n = SPLINE_SPANS + 3, len = x.size();
+        basis.assign(len * n, 0.0);
+        for (size_t k = 0; k < len; k++) {
+            double w[4];
+            const int i = spline_weights(u[k], range, w);
+            for (int j = 0; j < 4; j++) basis[k * n + i + j] = w[j];
+        }
+        for (const Section& s : post) {
+            const Coefs c = design(s);
+            std::vector<double> z0(n, 0.0), z1(n, 0.0);
+            for (size_t k = 0; k < len; k++) {
+                double* row = &basis[k * n];
+                for (size_t j = 0; j < n; j++) {
+                    const double v = row[j];
+                    const double y = c.b0 * v + z0[j];
+                    z0[j] = c.b1 * v - c.a1 * y + z1[j];
+                    z1[j] = c.b2 * v - c.a2 * y;
+                    row[j] = y;
+                }
+            }
+        }
+
+        std::vector<double> A(n * n, 0.0), r(n, 0.0);
+        for (size_t k = 0; k < len; k++) {
+            const double* row = &basis[k * n];
+            for (size_t i = 0; i < n; i++) {
+                for (size_t j = 0; j <= i; j++) A[i * n + j] += row[i] * row[j];
+                r[i] += row[i] * y[k];
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j < i; j++) A[j * n + i] = A[i * n + j];
+        }
+        // Keep the spline smooth where the data is thin (the ends)
+        double trace = 0.0;
+        for (size_t i = 0; i < n; i++) trace += A[i * n + i];
+        const double lambda = SHAPE_SMOOTHING * trace / n;
+        for (size_t i = 1; i + 1 < n; i++) {
+            const int d[3] = { (int)i - 1, (int)i, (int)i + 1 };
+            const double c[3] = { 1.0, -2.0, 1.0 };
+            for (int a = 0; a < 3; a++) {
+                for (int b = 0; b < 3; b++) A[d[a] * n + d[b]] += lambda * c[a] * c[b];
+            }
+        }
+        solve(A, r, n);
+        shape = r;
+
+        std::vector<double> res = y;
+        for (size_t k = 0; k < len; k++) {
+            for (size_t i = 0; i < n; i++) res[k] -= shape[i] * basis[k * n + i];
+        }
+        return res;
+    }
+
+    double Shape(double u) const {
+        double w[4];
+        const int i = spline_weights(u, range, w);
+        return w[0] * shape[i] + w[1] * shape[i + 1] + w[2] * shape[i + 2] + w[3] * shape[i + 3];
+    }
+};
+
+static double sum_squares(const std::vector<double>& v) {
+    double acc = 0.0;
+    for (double x : v) acc += x * x;
+    return acc;
+}
+
+// Levenberg-Marquardt over the filter parameters, numerical Jacobian
+static void refine(WhFit& fit, const std::vector<double>& x, const std::vector<double>& y) {
+    std::vector<double> p = fit.Params();
+    const size_t n = p.size(), m = x.size();
+    double lambda = 1e-2;
+    std::vector<double> r = fit.Solve(x, y);
+    double cost = sum_squares(r);
+    std::vector<double> J(m * n);
+    for (int it = 0; it < LM_ITERATIONS; it++) {
+        for (size_t i = 0; i < n; i++) {
+            std::vector<double> q = p;
+            const double h = 1e-4;
+            q[i] += h;
+            fit.SetParams(q);
+            const std::vector<double> rq = fit.Solve(x, y);
+            for (size_t k = 0; k < m; k++) J[k * n + i] = (rq[k] - r[k]) / h;
+        }
+        fit.SetParams(p);
+
+        std::vector<double> JtJ(n * n, 0.0), g(n, 0.0);
+        for (size_t k = 0; k < m; k++) {
+            const double* row = &J[k * n];
+            for (size_t i = 0; i < n; i++) {
+                g[i] -= row[i] * r[k];
+                for (size_t j = 0; j <= i; j++) JtJ[i * n + j] += row[i] * row[j];
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j < i; j++) JtJ[j * n + i] = JtJ[i * n + j];
+        }
+
+        bool improved = false, converged = false;
+        while (!improved && lambda < 1e6) {
+            std::vector<double> A = JtJ, d = g;
+            // Floor on the damping: a flat peak has no Jacobian for its f and Q
+            double diag = 0.0;
+            for (size_t i = 0; i < n; i++) diag = std::max(diag, A[i * n + i]);
+            for (size_t i = 0; i < n; i++) A[i * n + i] += lambda * std::max(A[i * n + i], 1e-6 * diag);
+            if (!solve(A, d, n)) {
+                lambda *= 10.0;
+                continue;
+            }
+            std::vector<double> q = p;
+            for (size_t i = 0; i < n; i++) q[i] += d[i];
+            fit.SetParams(q);
+            std::vector<double> rq = fit.Solve(x, y);
+            const double c = sum_squares(rq);
+            if (c < cost) {
+                converged = cost - c < LM_TOLERANCE * cost;
+                cost = c;
+                p = fit.Params();
+                r = rq;
+                lambda = std::max(lambda * 0.3, 1e-7);
+                improved = true;
+            } else {
+                lambda *= 10.0;
+            }
+        }
+        fit.SetParams(p);
+        if (!improved || converged) break;
+    }
+    fit.Solve(x, y);
+}
+
+// Karplus-Strong pluck added into x at `start`
+static void pluck(std::vector<double>& x, size_t start, double freq, double peak, std::mt19937& rng) {
+    std::uniform_real_distribution<double> uni(-1.0, 1.0);
+    const size_t period = (size_t)(SAMPLE_RATE / freq);
+    std::vector<double> line(period);
+    double lp = 0.0;
+    for (double& v : line) {
+        lp += 0.5 * (uni(rng) - lp);    // a pick, not a hammer: no harsh top
+        v = lp;
+    }
+    double max = 1e-9;
+    for (double v : line) max = std::max(max, fabs(v));
+    for (size_t k = 0; start + k < x.size() && k < (size_t)(1.5 * SAMPLE_RATE); k++) {
+        const size_t i = k % period;
+        const double v = line[i];
+        line[i] = 0.996 * 0.5 * (v + line[(i + 1) % period]);
+        x[start + k] += peak * v / max;
+    }
+}
+
+// Notes and chords from E2 up, each at a random level over the input range
+static void plucks(std::vector<double>& x, size_t from, size_t to, std::mt19937& rng) {
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    const size_t step = (size_t)(0.2 * SAMPLE_RATE);
+    for (size_t start = from; start + step <= to; start += step) {
+        const double peak = INPUT_PEAK * pow(10.0, -1.5 * uni(rng));    // 30 dB of dynamics
+        const int root = 40 + (int)(24 * uni(rng));
+        const int chord = uni(rng) < 0.4 ? 3 : 1;
+        for (int n = 0; n < chord; n++) {
+            const int note = root + (n == 0 ? 0 : n == 1 ? 7 : 12);
+            pluck(x, start, 440.0 * pow(2.0, (note - 69) / 12.0), peak / chord, rng);
+        }
+    }
+    for (size_t k = to; k < x.size(); k++) x[k] = 0.0;
+}
+
+static void training_signal(std::vector<double>& x) {
+    const size_t len = (size_t)(TRAIN_SECONDS * SAMPLE_RATE);
+    x.assign(len, 0.0);
+    std::mt19937 rng(1);
+    plucks(x, 0, len * 6 / 10, rng);
+
+    // Pinkish noise rising over the whole input range
+    std::normal_distribution<double> norm(0.0, 1.0);
+    double lp = 0.0;
+    const size_t a = len * 6 / 10, b = len * 85 / 100;
+    for (size_t k = a; k < b; k++) {
+        lp += 0.1 * (norm(rng) - lp);
+        const double level = 0.02 * pow(INPUT_PEAK / 0.02, (double)(k - a) / (b - a));
+        x[k] = level * lp;
+    }
+
+    // Log sweep 80 Hz..5 kHz at half level
+    double phase = 0.0;
+    for (size_t k = b; k < len; k++) {
+        const double t = (double)(k - b) / (len - b);
+        phase += 2.0 * M_PI * 80.0 * pow(5000.0 / 80.0, t) / SAMPLE_RATE;
+        x[k] = 0.5 * INPUT_PEAK * sin(phase);
+    }
+}
+
+static void check_signal(std::vector<double>& x) {
+    x.assign((size_t)(CHECK_SECONDS * SAMPLE_RATE), 0.0);
+    std::mt19937 rng(7);
+    plucks(x, 0, x.size(), rng);
+}
+
+// The GRU's output (without the engine's skip path)
+static std::vector<double> render(AmpModel& model, const std::vector<double>& x) {
+    std::vector<float> in(x.begin(), x.end()), out(x.size());
+    ResetAmpModel(model);
+    ProcessAmpModel(model, in.data(), out.data(), in.size());
+    return std::vector<double>(out.begin(), out.end());
+}
+
+static void to_data(const WhFit& fit, WhLiteData& d) {
+    for (int s = 0; s < WH_PRE_SECTIONS; s++) {
+        const Coefs c = design(fit.pre[s]);
+        const double v[5] = { c.b0, c.b1, c.b2, c.a1, c.a2 };
+        for (int j = 0; j < 5; j++) d.pre[s][j] = (float)v[j];
+    }
+    for (int s = 0; s < WH_POST_SECTIONS; s++) {
+        const Coefs c = design(fit.post[s]);
+        const double v[5] = { c.b0, c.b1, c.b2, c.a1, c.a2 };
+        for (int j = 0; j < 5; j++) d.post[s][j] = (float)v[j];
+    }
+    d.range = (float)fit.range;
+    for (int k = 0; k < WH_TABLE_SIZE; k++) {
+        d.table[k] = (float)fit.Shape(-fit.range + 2.0 * fit.range * k / (WH_TABLE_SIZE - 1));
+    }
+}
+
+// ESR of the amp output (skip path included) with the float runtime
+static double runtime_esr(const WhLiteData& d, const std::vector<double>& x, const std::vector<double>& y) {
+    static WhLite lite;
+    lite.Load(d);
+    std::vector<float> in(x.begin(), x.end()), out(x.size());
+    for (size_t k = 0; k < in.size(); k += 256) {
+        const size_t n = std::min((size_t)256, in.size() - k);
+        lite.Process(&in[k], &out[k], n);
+    }
+    double err = 0.0, sig = 0.0;
+    for (size_t k = 0; k < x.size(); k++) {
+        const double e = out[k] - y[k];
+        err += e * e;
+        sig += (y[k] + x[k]) * (y[k] + x[k]);
+    }
+    return err / std::max(sig, 1e-12);
+}
+
+static void write_data(FILE* out, const char* name, const WhLiteData& d) {
+    fprintf(out, "const WhLiteData %s = {\n    {", name);
+    for (int s = 0; s < WH_PRE_SECTIONS; s++) {
+        fprintf(out, " { %.9g, %.9g, %.9g, %.9g, %.9g }%s", d.pre[s][0], d.pre[s][1], d.pre[s][2],
+                d.pre[s][3], d.pre[s][4], s + 1 < WH_PRE_SECTIONS ? "," : " },\n    {");
+    }
+    for (int s = 0; s < WH_POST_SECTIONS; s++) {
+        fprintf(out, " { %.9g, %.9g, %.9g, %.9g, %.9g }%s", d.post[s][0], d.post[s][1], d.post[s][2],
+                d.post[s][3], d.post[s][4], s + 1 < WH_POST_SECTIONS ? "," : " },\n");
+    }
+    fprintf(out, "    %.9g,\n    {", d.range);
+    for (int k = 0; k < WH_TABLE_SIZE; k++) {
+        fprintf(out, "%s%.9g%s", k % 8 == 0 ? "\n        " : " ", d.table[k], k + 1 < WH_TABLE_SIZE ? "," : "");
+    }
+    fprintf(out, "\n    },\n    %.6g\n};\n", d.esr);
+}
+
+static const char* verdict(double esr) {
+    return esr < ESR_CLOSE ? "close" : esr < ESR_FALLBACK ? "fallback" : "keep the GRU";
+}
+
+int main(int argc, char** argv) {
+    const char* out_path = "wh_lite_data.h";
+    int opt;
+    while ((opt = getopt(argc, argv, "o:")) != -1) {
+        switch (opt) {
+            case 'o': out_path = optarg; break;
+            default:
+                fprintf(stderr, "usage: wh_distill [-o output.h]\n");
+                return 2;
+        }
+    }
+
+    setupWeights();
+    std::vector<double> train, check;
+    training_signal(train);
+    check_signal(check);
+
+    std::vector<WhLiteData> lites(model_collection.size());
+    std::vector<bool> fitted(model_collection.size(), false);
+    static AmpModel model;
+    for (size_t m = 0; m < model_collection.size(); m++) {
+        const modelData& md = model_collection[m];
+        if (!ModelShapeValid(md) || md.inputSize != 1) {
+            printf("Model %zu: conditioned or invalid, skipped\n", m + 1);
+            continue;
+        }
+        LoadModelWeights(model, md);
+        const std::vector<double> y = render(model, train);
+        const std::vector<double> y_check = render(model, check);
+        std::vector<double> t = y;      // amp output, see wh_lite.h
+        for (size_t k = 0; k < t.size(); k++) t[k] += train[k];
+
+        // Peaks start at 1 dB, a flat one has no gradient for its frequency and Q
+        WhFit fit;
+        fit.pre[0] = { SEC_HIGHPASS, log(40.0), 0.0, log(0.707) };
+        fit.pre[1] = { SEC_PEAK, log(700.0), 1.0, log(0.7) };
+        fit.post[0] = { SEC_LOWPASS, log(8000.0), 0.0, log(0.707) };
+        fit.post[1] = { SEC_PEAK, log(150.0), 1.0, log(0.7) };
+        fit.post[2] = { SEC_PEAK, log(2000.0), 1.0, log(0.7) };
+        refine(fit, train, t);
+
+        WhLiteData& d = lites[m];
+        to_data(fit, d);
+        const double esr_train = runtime_esr(d, train, y);
+        d.esr = (float)runtime_esr(d, check, y_check);
+        fitted[m] = true;
+        printf("Model %zu (%s): ESR %.4f held out, %.4f training -> %s\n", m + 1, archName[md.arch], d.esr,
+               esr_train, verdict(d.esr));
+    }
+
+    FILE* out = fopen(out_path, "w");
+    if (!out) {
+        fprintf(stderr, "can't write %s\n", out_path);
+        return 1;
+    }
+    fprintf(out, "// Lite amp models, generated by host/wh_distill from %s (`make wh-distill`), don't edit.\n",
+            "all_model_data_gru9_4count.h");
+    fprintf(out, "// ModelNLite is distilled from ModelN. ESR against the GRU on held-out plucks\n");
+    fprintf(out, "// (under %.2f close, under %.2f a fallback for when the GRU doesn't fit, no table\n", ESR_CLOSE,
+            ESR_FALLBACK);
+    fprintf(out, "// is written for the others):\n");
+    for (size_t m = 0; m < lites.size(); m++) {
+        if (fitted[m]) {
+            fprintf(out, "//   Model %zu: %.4f, %s\n", m + 1, lites[m].esr, verdict(lites[m].esr));
+        }
+    }
+    fprintf(out, "\n#pragma once\n\n#include \"wh_lite.h\"\n\n");
+    for (size_t m = 0; m < lites.size(); m++) {
+        if (!fitted[m] || lites[m].esr >= ESR_FALLBACK) continue;
+        char name[32];
+        snprintf(name, sizeof(name), "Model%zuLite", m + 1);
+        write_data(out, name, lites[m]);
+        fprintf(out, "\n");
+    }
+    fclose(out);
+    printf("wrote %s\n", out_path);
+    return 0;
+}
@@ -0,0 +1,214 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Work-stealing thread pool for the host server
+//   ParallelFor(count, fn) runs fn(i) for every i and returns when all are done.
+//   Index i is queued on worker i % Threads(), so with a steady workload the same
+//   job lands on the same thread (and core, with Pin()) every time and its state
+//   stays in that core's cache. A worker that runs out of its own jobs steals
+//   from the other end of another worker's deque, which only happens when the
+//   load is uneven. The calling thread is worker 0.
+//   Each worker counts the jobs it ran and the time it spent in them, so the
+//   caller can see how the work actually spread over the threads.
+
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+  public:
+    explicit WorkStealingPool(unsigned threads) {
+        if (threads == 0) {
+            threads = 1;
+        }
+        for (unsigned w = 0; w < threads; w++) {
+            queues.emplace_back(new Queue);
+        }
+        for (unsigned w = 1; w < threads; w++) {
+            workers.emplace_back([this, w] { WorkerLoop(w); });
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            stopping = true;
+            generation++;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) {
+            t.join();
+        }
+    }
+
+    unsigned Threads() const {
+        return (unsigned)queues.size();
+    }
+
+    // Pin worker w to CPU w (the caller's thread is worker 0). Best effort.
+    void Pin() {
+        unsigned cpus = std::thread::hardware_concurrency();
+        if (cpus == 0) {
+            return;
+        }
+        PinThread(pthread_self(), 0);
+        for (size_t w = 1; w < queues.size(); w++) {
+            PinThread(workers[w - 1].native_handle(), (unsigned)(w % cpus));
+        }
+    }
+
+    void ParallelFor(size_t count, const std::function<void(size_t)>& fn) {
+        // Set before queueing: a worker still finishing the last round may pick
+        // up a job as soon as it is queued
+        job = &fn;
+        remaining.store(count, std::memory_order_release);
+        const size_t n = queues.size();
+        for (size_t i = 0; i < count; i++) {
+            Queue& q = *queues[i % n];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.jobs.push_back(i);
+        }
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            generation++;
+        }
+        wake.notify_all();
+
+        RunJobs(0);
+        while (remaining.load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+        job = nullptr;
+    }
+
+    // Jobs taken from another worker's queue since the last ResetStats()
+    size_t Steals() const {
+        return steals.load(std::memory_order_relaxed);
+    }
+
+    struct WorkerStats {
+        size_t jobs;                // run by this worker, its own and stolen
+        double busy_s;              // time spent in them
+    };
+
+    // Since the last ResetStats(). Between ParallelFor() calls only.
+    WorkerStats Stats(unsigned w) const {
+        const Queue& q = *queues[w];
+        return { q.ran, q.busy_ns * 1e-9 };
+    }
+
+    void ResetStats() {
+        steals.store(0, std::memory_order_relaxed);
+        for (std::unique_ptr<Queue>& q : queues) {
+            q->ran = 0;
+            q->busy_ns = 0;
+        }
+    }
+
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> jobs;
+        // Written by the owning worker only, read once `remaining` is back to 0
+        size_t ran = 0;
+        uint64_t busy_ns = 0;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    unsigned long generation = 0;
+    bool stopping = false;
+
+    const std::function<void(size_t)>* job = nullptr;
+    std::atomic<size_t> remaining{0};
+    std::atomic<size_t> steals{0};
+
+    static void PinThread(pthread_t thread, unsigned cpu) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(thread, sizeof(set), &set);
+    }
+
+    void WorkerLoop(unsigned w) {
+        unsigned long seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(wake_mutex);
+                wake.wait(lock, [&] { return generation != seen; });
+                seen = generation;
+                if (stopping) {
+                    return;
+                }
+            }
+            RunJobs(w);
+        }
+    }
+
+    // Own jobs newest first, then steal oldest first from the others
+    void RunJobs(unsigned w) {
+        const size_t n = queues.size();
+        size_t i;
+        while (Pop(*queues[w], i, false)) {
+            Run(w, i);
+        }
+        for (size_t k = 1; k < n; k++) {
+            Queue& victim = *queues[(w + k) % n];
+            while (Pop(victim, i, true)) {
+                steals.fetch_add(1, std::memory_order_relaxed);
+                Run(w, i);
+            }
+        }
+    }
+
+    static bool Pop(Queue& q, size_t& i, bool steal) {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.jobs.empty()) {
+            return false;
+        }
+        if (steal) {
+            i = q.jobs.front();
+            q.jobs.pop_front();
+        } else {
+            i = q.jobs.back();
+            q.jobs.pop_back();
+        }
+        return true;
+    }
+
+    void Run(unsigned w, size_t i) {
+        const auto start = std::chrono::steady_clock::now();
+        (*job)(i);
+        Queue& q = *queues[w];
+        q.ran++;
+        q.busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }
+};
@@ -1,29 +1,54 @@
+#pragma once
+
 #include <math.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 
-#define MAX_DELAY_SAMPLES 48000 // 1 сек @ 48кГц
+// Найдовша лінія: max_time (0.1 с) * найбільший множник (2.23) @ 48кГц = 10704
+// відліки, округлено до кратного 256. На вищих частотах дискретизації лінії обрізаються
+#define MAX_DELAY_SAMPLES 10752
 #define NUM_DELAYS 4
+#define NUM_CHANNELS 2
 #define FEEDBACK 0.7f
 #define DAMP 0.4f
 #define OUT_GAIN 0.35f
 
+// Пам'ять буферів передається в Init(): буфери великі й лежать в SDRAM,
+// а голови (позиції, стан фільтра) — в самому об'єкті, у швидкій пам'яті
+#define REVERB_MEM_SIZE (NUM_CHANNELS * NUM_DELAYS * MAX_DELAY_SAMPLES)
+
 struct DelayLine {
-    float buf[MAX_DELAY_SAMPLES];
+    float* buf;
     int size;
     int write_pos;
     int read_pos;
     float filter_state;
+    int mute;           // скільки ще читань пропустити (застарілий вміст)
+};
+
+// Множники довжин ліній для кожного каналу. Лівий канал — як у моно версії,
+// правий має інші довжини, щоб хвости були декорельовані
+static const float delay_ratios[NUM_CHANNELS][NUM_DELAYS] = {
+    { 1.0f,  1.3f,  1.7f,  2.1f  },
+    { 1.07f, 1.39f, 1.61f, 2.23f }
 };
 
 class LiteReverb {
   public:
-    void Init(float sr) {
+    // mem: REVERB_MEM_SIZE floats
+    void Init(float sr, float* mem) {
         sample_rate = sr;
         room_size = 0.5f;
         decay = 0.7f;
 
+        for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+            for (int i = 0; i < NUM_DELAYS; i++) {
+                delays[i][ch].buf = &mem[(ch * NUM_DELAYS + i) * MAX_DELAY_SAMPLES];
+                delays[i][ch].size = 0;
+                delays[i][ch].mute = 0;
+            }
+        }
         UpdateDelays();
     }
 
@@ -38,10 +63,11 @@ class LiteReverb {
         decay = d;
     }
 
+    // Моно: лише лівий набір ліній
     float Process(float in) {
         float acc = 0.0f;
         for (int i = 0; i < NUM_DELAYS; i++) {
-            DelayLine &d = delays[i];
+            DelayLine &d = delays[i][0];
 
             // просте читання без інтерполяції
             float y = d.buf[d.read_pos];
@@ -62,32 +88,72 @@ class LiteReverb {
         return acc * OUT_GAIN;
     }
 
+    // Стерео: обидва набори ліній в одному проході, канал — це "лінія" SIMD.
+    // Лінії каналу лежать поруч (delays[i][0..1]), тож внутрішній цикл по каналах
+    // компілятор може векторизувати; на M7 (без float SIMD) виграш у спільному
+    // циклі та керуванні, а не в інструкціях
+    void ProcessStereo(float in, float* outL, float* outR) {
+        float acc[NUM_CHANNELS] = { 0.0f, 0.0f };
+        for (int i = 0; i < NUM_DELAYS; i++) {
+            DelayLine* d = delays[i];
+            for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+                float y = d[ch].buf[d[ch].read_pos];
+                if (d[ch].mute > 0) {
+                    d[ch].mute--;
+                    y = 0.0f;
+                }
+
+                d[ch].filter_state = (1.0f - DAMP) * y + DAMP * d[ch].filter_state;
+                d[ch].buf[d[ch].write_pos] = in + d[ch].filter_state * decay;
+
+                if (++d[ch].write_pos >= d[ch].size) d[ch].write_pos = 0;
+                if (++d[ch].read_pos >= d[ch].size) d[ch].read_pos = 0;
+
+                acc[ch] += y;
+            }
+        }
+        *outL = acc[0] * OUT_GAIN;
+        *outR = acc[1] * OUT_GAIN;
+    }
+
+    // Праві лінії знову в роботі після паузи (моно Process() під навантаженням).
+    // У буфері лишився старий хвіст; чистити його з колбеку задорого (SDRAM),
+    // тож поки лінія не перезапише прочитане, читання дають нуль — те саме,
+    // що й чистий буфер
+    void ResumeRight() {
+        for (int i = 0; i < NUM_DELAYS; i++) {
+            DelayLine &d = delays[i][1];
+            d.mute = d.size - d.size / 2;
+            d.filter_state = 0.0f;
+        }
+    }
+
   private:
     float sample_rate;
     float room_size;
     float decay;
-    DelayLine delays[NUM_DELAYS];
+    DelayLine delays[NUM_DELAYS][NUM_CHANNELS];
 
     void UpdateDelays() {
         float min_time = 0.010f;
         float max_time = 0.100f;
         float base_time = min_time + room_size * (max_time - min_time);
 
-        // Дві різні довжини (≈30 мс і 45 мс)
-        float times[NUM_DELAYS] = {
-            base_time,
-            base_time * 1.3f,
-            base_time * 1.7f,
-            base_time * 2.1f
-        };
-        for (int i = 0; i < NUM_DELAYS; i++) {
-            delays[i].size = (int)(sample_rate * times[i]);
-            if (delays[i].size > MAX_DELAY_SAMPLES)
-                delays[i].size = MAX_DELAY_SAMPLES;
-            delays[i].write_pos = 0;
-            delays[i].read_pos = delays[i].size / 2;
-            delays[i].filter_state = 0.0f;
-            memset(delays[i].buf, 0, sizeof(float) * delays[i].size);
+        for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+            for (int i = 0; i < NUM_DELAYS; i++) {
+                DelayLine &d = delays[i][ch];
+                int old_size = d.size;
+                d.size = (int)(sample_rate * base_time * delay_ratios[ch][i]);
+                if (d.size > MAX_DELAY_SAMPLES)
+                    d.size = MAX_DELAY_SAMPLES;
+                d.write_pos = 0;
+                d.read_pos = d.size / 2;
+                d.filter_state = 0.0f;
+                // Викликається з аудіо колбеку при зміні розміру кімнати:
+                // обнуляємо лише нову частину буфера, а не весь буфер
+                if (d.size > old_size)
+                    memset(&d.buf[old_size], 0, sizeof(float) * (d.size - old_size));
+            }
         }
     }
 };
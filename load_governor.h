@@ -0,0 +1,196 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// DSP load governor
+//   setup_model() refuses models that don't fit by the boot-time cost probes,
+//   but the real callback can still get close to the deadline (long IR, stereo
+//   reverb, a knob that makes the reverb lines longer, ...). The governor runs at
+//   the end of every callback with that block's measured load (callback time /
+//   block period) and steps the quality down, one level at a time, in order:
+//     QUALITY_IR_TRIM      convolve only the first IR_TRIM_LENGTH taps of the cab
+//     QUALITY_REVERB_LITE  mono reverb lines, no width
+//     QUALITY_AMP_BYPASS   amp model crossfaded out
+//   The engine fades every change in, see AltairEngine::SetQuality().
+//   Hysteresis: down after step_down_blocks over step_down (or at once on a
+//   missed deadline), up only after the average load has stayed under the lower
+//   step_up for step_up_blocks. Each step down remembers what it
+//   saved; a step up is only taken if the average load plus that saving stays
+//   under step_down, otherwise it waits another step_up_blocks. The saving is
+//   only replaced by a new measure: the next step down from the same level, or
+//   Remeasure() for a stage that doesn't run at all once stepped down (the amp,
+//   which the engine keeps probing). So the governor doesn't probe its way
+//   back into an overload while the slow stage is still slow. A step up that
+//   overloads within probe_blocks anyway is undone and the next attempt waits
+//   twice as long.
+//   Transitions go to the main loop through a lock-free ring for logging.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spsc_ring.h"
+
+enum QualityLevel {
+    QUALITY_FULL,
+    QUALITY_IR_TRIM,
+    QUALITY_REVERB_LITE,
+    QUALITY_AMP_BYPASS,
+    QUALITY_COUNT
+};
+
+const char* const qualityName[QUALITY_COUNT] = { "full", "IR trimmed", "reverb lite", "amp bypassed" };
+
+struct GovernorConfig {
+    float step_down = 0.85f;        // block load that counts as overload
+    float panic = 1.0f;             // a single block over this (a missed deadline) steps down at once
+    int step_down_blocks = 3;       // overloaded blocks in a row before stepping down
+    float step_up = 0.70f;          // block load that counts as headroom
+    int step_up_blocks = 480;       // ~2.5 s at 256 samples / 48 kHz
+    int max_up_blocks = 1920;       // backoff limit, ~10 s
+    int settle_blocks = 16;         // after a change, let the crossfades finish before judging
+    float smooth = 0.05f;           // average load for stepping up, ~20 blocks
+    int probe_blocks = 96;          // a step up that overloads within this is undone
+};
+
+struct GovernorEvent {
+    uint32_t block;                 // blocks since Init()
+    uint8_t from;
+    uint8_t to;
+    float load;                     // block load that triggered it
+};
+
+typedef SpscRing<GovernorEvent, 16> GovernorLog;
+
+class LoadGovernor {
+  public:
+    // log may be null
+    void Init(const GovernorConfig& cfg, GovernorLog* l) {
+        config = cfg;
+        log = l;
+        Reset();
+    }
+
+    void Reset() {
+        level = QUALITY_FULL;
+        block = 0;
+        over = under = 0;
+        settle = 0;
+        probe = 0;
+        up_wait = config.step_up_blocks;
+        peak_level = QUALITY_FULL;
+        average = 0.0f;
+        measure_saving = false;
+        for (int q = 0; q < QUALITY_COUNT; q++) {
+            saving[q] = 0.0f;
+        }
+    }
+
+    // Audio callback, before Update(): a fresh measure of the load that stepping
+    //   down to `to` saves (what the stage it turns off would cost now)
+    void Remeasure(QualityLevel to, float load) {
+        if (to > QUALITY_FULL && to < QUALITY_COUNT) {
+            saving[to - 1] = load;
+        }
+    }
+
+    // Audio callback, once per block. Returns the level for the next block.
+    QualityLevel Update(float load) {
+        block++;
+        average += config.smooth * (load - average);
+        if (settle > 0) {
+            settle--;
+            // A missed deadline doesn't wait for the fades
+            if (load <= config.panic) {
+                return level;
+            }
+            settle = 0;
+            measure_saving = false;
+        }
+        if (measure_saving) {
+            // First settled block after a step down
+            measure_saving = false;
+            saving[level - 1] = step_load > load ? step_load - load : 0.0f;
+        }
+        if (probe > 0) {
+            probe--;
+            if (probe == 0) {
+                up_wait = config.step_up_blocks;    // the step up held
+            }
+        }
+
+        over = load > config.step_down ? over + 1 : 0;
+        under = average < config.step_up ? under + 1 : 0;
+
+        if (level < QUALITY_AMP_BYPASS && (over >= config.step_down_blocks || load > config.panic)) {
+            if (probe > 0) {
+                // The last step up didn't fit after all: back off
+                probe = 0;
+                up_wait = up_wait * 2 < config.max_up_blocks ? up_wait * 2 : config.max_up_blocks;
+            }
+            Step((QualityLevel)(level + 1), load);
+        } else if (level > QUALITY_FULL && under >= up_wait) {
+            if (average + saving[level - 1] >= config.step_down) {
+                under = 0;      // still wouldn't fit
+            } else {
+                Step((QualityLevel)(level - 1), load);
+                probe = config.probe_blocks;
+            }
+        }
+        return level;
+    }
+
+    QualityLevel Level() const {
+        return level;
+    }
+
+    // Lowest quality reached since Init()
+    QualityLevel PeakLevel() const {
+        return peak_level;
+    }
+
+  private:
+    GovernorConfig config;
+    GovernorLog* log;
+    QualityLevel level;
+    QualityLevel peak_level;
+    uint32_t block;
+    int over, under;
+    int settle;
+    int probe;
+    int up_wait;
+    float average;
+    float saving[QUALITY_COUNT];    // load each step down saved, by the level it left
+    float step_load;
+    bool measure_saving;
+
+    void Step(QualityLevel to, float load) {
+        if (log) {
+            GovernorEvent e = { block, (uint8_t)level, (uint8_t)to, load };
+            log->Push(e);
+        }
+        if (to > level) {
+            step_load = load;
+            measure_saving = true;
+        }
+        level = to;
+        if (to > peak_level) {
+            peak_level = to;
+        }
+        over = under = 0;
+        settle = config.settle_blocks;
+    }
+};
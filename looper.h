@@ -0,0 +1,263 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Mono looper: minutes of loop in SDRAM
+//   Like the delay, the buffer is only touched in contiguous bursts: per block
+//   the span under the loop head is copied into a staging buffer, played back
+//   and overdubbed there as a block mix (loop = loop + dub * in), and copied
+//   back in one go. Recording only writes, playing only reads, so a block moves
+//   at most one block each way (two bursts each if it crosses the loop point).
+//   The buffer is never cleared: recording overwrites, and playback only reads
+//   what was recorded.
+//   Every change fades over LOOPER_FADE_SAMPLES. Recording starts faded in and
+//   keeps going, fading out, over the start of the loop once it's closed, so the
+//   loop point is a crossfade; overdubs punch in and out the same way, and stop
+//   fades the playback out.
+//   Requests come from the control context (Request()) and are taken at the
+//   start of the next block, the last one wins.
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef MAX_BLOCK_SIZE
+#define MAX_BLOCK_SIZE 256
+#endif
+
+#define LOOPER_MAX_SECONDS 240
+#define LOOPER_MEM_SIZE (LOOPER_MAX_SECONDS * 48000)    // at 48 kHz, ~46 MB
+#define LOOPER_MIN_SECONDS 0.25f                        // shorter recordings are dropped
+#define LOOPER_FADE_SAMPLES 240.0f                      // 5 ms
+#define LOOPER_LEVEL 1.0f
+
+class Looper {
+  public:
+    enum State { EMPTY, RECORDING, PLAYING, OVERDUBBING, STOPPED };
+
+    enum Action {
+        NONE,
+        TAP,        // empty: record, recording: close and play, playing: overdub,
+                    // overdubbing: play, stopped: play from the start
+        STOP,       // recording: close and stop, playing/overdubbing: stop,
+                    // stopped: clear
+    };
+
+    // SDRAM traffic since the last ResetTraffic()
+    struct Traffic {
+        uint32_t bursts;
+        uint32_t bytes;
+    };
+
+    // mem: size floats (LOOPER_MEM_SIZE), may be null for no looper
+    void Init(float sr, float* mem, size_t size) {
+        buf = mem;
+        capacity = mem ? size : 0;
+        min_length = (size_t)(LOOPER_MIN_SECONDS * sr);
+        length = pos = 0;
+        dub = play = 0.0f;
+        state.store(EMPTY, std::memory_order_relaxed);
+        request.store(NONE, std::memory_order_relaxed);
+        ResetTraffic();
+    }
+
+    // Control context
+    void Request(Action a) {
+        request.store(a, std::memory_order_release);
+    }
+
+    State GetState() const {
+        return state.load(std::memory_order_relaxed);
+    }
+
+    float MaxSeconds(float sr) const {
+        return capacity / sr;
+    }
+
+    const Traffic& GetTraffic() const {
+        return traffic;
+    }
+
+    void ResetTraffic() {
+        traffic.bursts = traffic.bytes = 0;
+    }
+
+    // In place: records/overdubs io, adds the loop to it
+    void Process(float* io, size_t size) {
+        if (capacity == 0 || size == 0 || size > MAX_BLOCK_SIZE) {
+            return;
+        }
+        State s = state.load(std::memory_order_relaxed);
+        s = Take(s, (Action)request.exchange(NONE, std::memory_order_acquire));
+
+        if (s == RECORDING) {
+            if (pos + size > capacity) {
+                s = Close(PLAYING);     // full, loop what's there
+            } else {
+                Record(io, size);
+                state.store(s, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        const float dub_target = s == OVERDUBBING ? 1.0f : 0.0f;
+        const float play_target = s == PLAYING || s == OVERDUBBING ? LOOPER_LEVEL : 0.0f;
+        size_t done = 0;
+        while (done < size && length > 0 && (dub > 0.0f || play > 0.0f || dub_target > 0.0f || play_target > 0.0f)) {
+            const size_t n = length - pos < size - done ? length - pos : size - done;
+            Mix(io + done, n, dub_target, play_target);
+            done += n;
+            pos += n;
+            if (pos == length) {
+                pos = 0;
+            }
+        }
+        if (s == STOPPED && dub == 0.0f && play == 0.0f) {
+            pos = 0;        // faded out, the next play starts from the top
+        }
+        state.store(s, std::memory_order_relaxed);
+    }
+
+  private:
+    float* buf;                 // SDRAM
+    size_t capacity;
+    size_t min_length;
+    size_t length;              // 0 while empty or recording
+    size_t pos;
+    float dub;                  // overdub gain, fades
+    float play;                 // playback gain, fades
+    std::atomic<State> state;
+    std::atomic<int> request;
+    Traffic traffic;
+
+    float stage[MAX_BLOCK_SIZE];
+
+    // Apply a request to the state
+    State Take(State s, Action a) {
+        if (a == TAP) {
+            switch (s) {
+                case EMPTY:
+                    pos = 0;
+                    dub = 0.0f;
+                    return RECORDING;
+                case RECORDING:
+                    return Close(PLAYING);
+                case PLAYING:
+                    return OVERDUBBING;
+                case OVERDUBBING:
+                case STOPPED:
+                    return PLAYING;
+            }
+        } else if (a == STOP) {
+            switch (s) {
+                case EMPTY:
+                    return EMPTY;
+                case RECORDING:
+                    return Close(STOPPED);
+                case PLAYING:
+                case OVERDUBBING:
+                    return STOPPED;
+                case STOPPED:
+                    if (dub > 0.0f || play > 0.0f) {
+                        return STOPPED;     // still fading, the loop is in use
+                    }
+                    length = pos = 0;
+                    return EMPTY;
+            }
+        }
+        return s;
+    }
+
+    // End of the first pass: the loop is what was recorded, the recording fades
+    //   out over its start from here on
+    State Close(State next) {
+        if (pos < min_length) {
+            pos = 0;
+            dub = 0.0f;
+            return EMPTY;
+        }
+        length = pos;
+        pos = 0;
+        play = next == PLAYING ? LOOPER_LEVEL : 0.0f;
+        return next;
+    }
+
+    // Where a 0..target fade is after n samples
+    static float Ramp(float from, float to, float max_gain, size_t n) {
+        const float max = max_gain * (float)n / LOOPER_FADE_SAMPLES;
+        if (to > from + max) return from + max;
+        if (to < from - max) return from - max;
+        return to;
+    }
+
+    // First pass: write only, fading in
+    void Record(const float* io, size_t size) {
+        const float end = Ramp(dub, 1.0f, 1.0f, size);
+        const float step = (end - dub) / size;
+        float d = dub;
+        for (size_t i = 0; i < size; i++) {
+            d += step;
+            stage[i] = d * io[i];
+        }
+        dub = end;
+        BurstWrite(pos, size);
+        pos += size;
+    }
+
+    // n samples from pos, not past the loop point
+    void Mix(float* io, size_t n, float dub_target, float play_target) {
+        const float dub_end = Ramp(dub, dub_target, 1.0f, n);
+        const float play_end = Ramp(play, play_target, LOOPER_LEVEL, n);
+        const bool write = dub > 0.0f || dub_end > 0.0f;
+        BurstRead(pos, n);
+
+        const float dub_step = (dub_end - dub) / n;
+        const float play_step = (play_end - play) / n;
+        float d = dub, p = play;
+        if (write) {
+            for (size_t i = 0; i < n; i++) {
+                const float x = io[i];
+                const float y = stage[i];
+                d += dub_step;
+                p += play_step;
+                stage[i] = y + d * x;
+                io[i] = x + p * y;
+            }
+            BurstWrite(pos, n);
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                p += play_step;
+                io[i] += p * stage[i];
+            }
+        }
+        dub = dub_end;
+        play = play_end;
+    }
+
+    void BurstRead(size_t start, size_t len) {
+        memcpy(stage, &buf[start], len * sizeof(float));
+        traffic.bursts++;
+        traffic.bytes += len * sizeof(float);
+    }
+
+    void BurstWrite(size_t start, size_t len) {
+        memcpy(&buf[start], stage, len * sizeof(float));
+        traffic.bursts++;
+        traffic.bytes += len * sizeof(float);
+    }
+};
@@ -0,0 +1,305 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Amp model registry
+//   Every model_collection entry declares its architecture. Each architecture is
+//   a statically sized RTNeural model, all of them live in one std::variant, so
+//   the per-sample code always runs on a fixed-size model and the architecture
+//   is dispatched once per block.
+//   A snapshot entry can also carry a lite model (wh_lite.h, distilled from it
+//   by host/wh_distill) and declare which of the two it runs: RUN_FULL (the
+//   default), RUN_LITE, or RUN_AUTO, where the firmware uses the recurrent
+//   model if it fits the callback budget and the lite one otherwise.
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <variant>
+#include <vector>
+
+#include <RTNeural/RTNeural.h>
+
+#include "wh_lite.h"
+
+// Order must match the AmpModel variant below
+enum ModelArch {
+    ARCH_GRU9,
+    ARCH_GRU8,
+    ARCH_GRU12,
+    ARCH_LSTM8,
+    ARCH_COUNT
+};
+
+enum ModelRun {
+    RUN_FULL,
+    RUN_LITE,
+    RUN_AUTO
+};
+
+struct modelData {
+  // One row per model input: row 0 is the audio input, rows 1.. are the knob
+  //   parameters of a conditioned model (2-3 inputs total, gates * hidden values per row)
+  std::vector<std::vector<float>> rec_weight_ih_l0; 
+  std::vector<std::vector<float>> rec_weight_hh_l0;  
+  std::vector<std::vector<float>> lin_weight;
+  std::vector<float> lin_bias;
+  std::vector<std::vector<float>> rec_bias;
+  float levelAdjust;
+  int inputSize = 1;    // 1 = snapshot, 2 = conditioned on KNOB 1, 3 = conditioned on KNOB 1 + KNOB 5
+  ModelArch arch = ARCH_GRU9;
+  const WhLiteData* lite = nullptr;     // distilled lite model, wh_lite_data.h
+  ModelRun run = RUN_FULL;
+};
+
+template <int N>
+using GRUModel = RTNeural::ModelT<float, 1, 1,
+                                  RTNeural::GRULayerT<float, 1, N>,
+                                  RTNeural::DenseT<float, N, 1>>;
+
+template <int N>
+using LSTMModel = RTNeural::ModelT<float, 1, 1,
+                                   RTNeural::LSTMLayerT<float, 1, N>,
+                                   RTNeural::DenseT<float, N, 1>>;
+
+using AmpModel = std::variant<GRUModel<9>, GRUModel<8>, GRUModel<12>, LSTMModel<8>>;
+
+const int archHiddenSize[ARCH_COUNT] = { 9, 8, 12, 8 };
+const int archGates[ARCH_COUNT]      = { 3, 3, 3, 4 };
+const char* const archName[ARCH_COUNT] = { "GRU 9", "GRU 8", "GRU 12", "LSTM 8" };
+
+template <typename M>
+struct IsLSTMModel : std::false_type {};
+
+template <int N>
+struct IsLSTMModel<LSTMModel<N>> : std::true_type {};
+
+// Construct the requested architecture in place (no-op if it is already active)
+inline void SelectArch(AmpModel& model, ModelArch arch) {
+    if ((int)model.index() == arch) {
+        return;
+    }
+    switch (arch) {
+    case ARCH_GRU8:
+        model.emplace<ARCH_GRU8>();
+        break;
+    case ARCH_GRU12:
+        model.emplace<ARCH_GRU12>();
+        break;
+    case ARCH_LSTM8:
+        model.emplace<ARCH_LSTM8>();
+        break;
+    case ARCH_GRU9:
+    default:
+        model.emplace<ARCH_GRU9>();
+        break;
+    }
+}
+
+// Check the weight shapes against the declared architecture before loading
+inline bool ModelShapeValid(const modelData& md) {
+    if (md.arch < 0 || md.arch >= ARCH_COUNT) {
+        return false;
+    }
+    const size_t hidden = archHiddenSize[md.arch];
+    const size_t width = archGates[md.arch] * hidden;
+
+    if (md.inputSize < 1 || md.rec_weight_ih_l0.size() != (size_t)md.inputSize) {
+        return false;
+    }
+    for (const auto& row : md.rec_weight_ih_l0) {
+        if (row.size() != width) {
+            return false;
+        }
+    }
+    if (md.rec_weight_hh_l0.size() != hidden || md.rec_weight_hh_l0[0].size() != width) {
+        return false;
+    }
+    if (md.rec_bias.empty() || md.rec_bias[0].size() != width) {
+        return false;
+    }
+    return md.lin_weight.size() == 1 && md.lin_weight[0].size() == hidden && md.lin_bias.size() == 1;
+}
+
+// Lite models stand in for snapshots only, conditioning has nowhere to go
+inline bool LiteAvailable(const modelData& md) {
+    return md.lite != nullptr && md.inputSize == 1;
+}
+
+// Recurrent bias in the layout SetRecBias() expects. GRU keeps the input and
+// hidden bias rows apart (the hidden bias sits inside the reset gate), LSTM
+// only has one bias so all rows are summed into row 0.
+inline void PrepareRecBias(const modelData& md, std::vector<std::vector<float>>& bias) {
+    bias = md.rec_bias;
+    if (md.arch == ARCH_LSTM8) {
+        for (size_t r = 1; r < bias.size(); r++) {
+            for (size_t j = 0; j < bias[0].size(); j++) {
+                bias[0][j] += bias[r][j];
+            }
+        }
+    }
+}
+
+// Row 0 of bias is the input-side bias, so conditioning can be folded into it.
+// Does not allocate, safe to call from the audio callback.
+inline void SetRecBias(AmpModel& model, const std::vector<std::vector<float>>& bias) {
+    std::visit([&](auto& m) {
+        using M = std::decay_t<decltype(m)>;
+        if constexpr (IsLSTMModel<M>::value) {
+            m.template get<0>().setBVals(bias[0]);
+        } else {
+            m.template get<0>().setBVals(bias);
+        }
+    }, model);
+}
+
+// Common weight loading interface for every architecture. Only the audio row of
+// rec_weight_ih_l0 goes into the recurrent layer, knob rows are folded into the
+// bias by the caller.
+inline void LoadModelWeights(AmpModel& model, const modelData& md) {
+    SelectArch(model, md.arch);
+
+    std::vector<std::vector<float>> bias;
+    PrepareRecBias(md, bias);
+
+    std::visit([&](auto& m) {
+        auto& rec = m.template get<0>();
+        auto& dense = m.template get<1>();
+        rec.setWVals({ md.rec_weight_ih_l0[0] });
+        rec.setUVals(md.rec_weight_hh_l0);
+        dense.setWeights(md.lin_weight);
+        dense.setBias(md.lin_bias.data());
+    }, model);
+    SetRecBias(model, bias);
+}
+
+inline void ResetAmpModel(AmpModel& model) {
+    std::visit([](auto& m) { m.reset(); }, model);
+}
+
+// Run the amp model over a block: one dispatch per block, the sample loop runs
+// on the concrete static model.
+inline void ProcessAmpModel(AmpModel& model, const float* in, float* out, size_t size) {
+    std::visit([&](auto& m) {
+        for (size_t i = 0; i < size; i++) {
+            out[i] = m.forward(&in[i]);
+        }
+    }, model);
+}
+
+// Host: one model's weights prepared once and shared read-only by any number of
+// engines, each running it on its own AmpState. RTNeural's static layers keep
+// their weights inline with their state, so this is the same forward written
+// against external weights: GRU gates z, r, c with the hidden bias inside the
+// reset gate, LSTM gates i, f, c, o, then the dense output.
+#define AMP_MAX_HIDDEN 12
+#define AMP_MAX_WIDTH (4 * AMP_MAX_HIDDEN)
+
+struct SharedAmpModel {
+    const modelData* md = nullptr;              // levelAdjust, conditioning rows, lite data
+    ModelArch arch = ARCH_GRU9;
+    int hidden = 0;
+    int width = 0;                              // gates * hidden
+    float w[AMP_MAX_WIDTH];                     // audio row of rec_weight_ih_l0
+    float u[AMP_MAX_HIDDEN][AMP_MAX_WIDTH];     // rec_weight_hh_l0
+    std::vector<std::vector<float>> bias;       // PrepareRecBias() layout
+    float denseW[AMP_MAX_HIDDEN];
+    float denseB = 0.0f;
+};
+
+// Per engine state on shared weights
+struct AmpState {
+    float h[AMP_MAX_HIDDEN];
+    float c[AMP_MAX_HIDDEN];                    // LSTM cell
+};
+
+// Setup only, allocates. False if the weights don't fit the architecture.
+inline bool PrepareSharedAmp(SharedAmpModel& s, const modelData& md) {
+    if (!ModelShapeValid(md)) {
+        return false;
+    }
+    s.md = &md;
+    s.arch = md.arch;
+    s.hidden = archHiddenSize[md.arch];
+    s.width = archGates[md.arch] * s.hidden;
+    for (int k = 0; k < s.width; k++) {
+        s.w[k] = md.rec_weight_ih_l0[0][k];
+        for (int i = 0; i < s.hidden; i++) {
+            s.u[i][k] = md.rec_weight_hh_l0[i][k];
+        }
+    }
+    PrepareRecBias(md, s.bias);
+    for (int i = 0; i < s.hidden; i++) {
+        s.denseW[i] = md.lin_weight[0][i];
+    }
+    s.denseB = md.lin_bias[0];
+    return true;
+}
+
+inline void ResetAmpState(AmpState& st) {
+    memset(&st, 0, sizeof(st));
+}
+
+inline float AmpSigmoid(float x) {
+    return 1.0f / (1.0f + expf(-x));
+}
+
+// ProcessAmpModel() on shared weights. bias: the model's (SharedAmpModel::bias),
+// or the engine's copy with the conditioning folded in.
+inline void ProcessSharedAmp(const SharedAmpModel& s, const std::vector<std::vector<float>>& bias,
+                             AmpState& st, const float* in, float* out, size_t size) {
+    const int n = s.hidden;
+    const float* b0 = bias[0].data();
+    float g[AMP_MAX_WIDTH];
+    for (size_t t = 0; t < size; t++) {
+        const float x = in[t];
+        if (s.arch == ARCH_LSTM8) {
+            for (int k = 0; k < s.width; k++) {
+                float a = b0[k] + s.w[k] * x;
+                for (int i = 0; i < n; i++) {
+                    a += s.u[i][k] * st.h[i];
+                }
+                g[k] = a;
+            }
+            for (int j = 0; j < n; j++) {
+                st.c[j] = AmpSigmoid(g[n + j]) * st.c[j] + AmpSigmoid(g[j]) * tanhf(g[2 * n + j]);
+                st.h[j] = AmpSigmoid(g[3 * n + j]) * tanhf(st.c[j]);
+            }
+        } else {
+            // Hidden side only, the candidate's is gated by r before the input side joins
+            const float* b1 = bias[1].data();
+            for (int k = 0; k < s.width; k++) {
+                float a = b1[k];
+                for (int i = 0; i < n; i++) {
+                    a += s.u[i][k] * st.h[i];
+                }
+                g[k] = a;
+            }
+            for (int j = 0; j < n; j++) {
+                const float z = AmpSigmoid(b0[j] + s.w[j] * x + g[j]);
+                const float r = AmpSigmoid(b0[n + j] + s.w[n + j] * x + g[n + j]);
+                const float c = tanhf(b0[2 * n + j] + s.w[2 * n + j] * x + r * g[2 * n + j]);
+                st.h[j] = (1.0f - z) * c + z * st.h[j];
+            }
+        }
+        float y = s.denseB;
+        for (int i = 0; i < n; i++) {
+            y += s.denseW[i] * st.h[i];
+        }
+        out[t] = y;
+    }
+}
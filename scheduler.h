@@ -0,0 +1,236 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Cooperative scheduler for the control context (main loop)
+//   Periodic tasks: plain functions run every period (controls, LEDs, log
+//   draining). A task that falls behind skips the missed runs instead of
+//   bursting to catch up.
+//   Deferred jobs: work too long to do in one go (recomputing a kernel,
+//   warming up a model, statistics) as a SlicedJob. Jobs queue up and run one
+//   at a time, a bounded Step() after another, for at most slice_us per Poll()
+//   so the periodic tasks keep their timing. A finished job's Publish() hands
+//   the result to the audio thread through the engine's non-blocking setters
+//   (SetIRKernel() and friends); while those refuse because the audio thread
+//   hasn't taken the last result yet, Publish() is retried on the next Poll().
+//   Submitting a job that is queued but not started yet changes nothing, it
+//   takes its inputs when it begins. Submitting a job that is already running
+//   latches another pass: the current one finishes and publishes, then the job
+//   goes to the back of the queue and starts over with the newest input. So a
+//   knob that keeps moving still gets a result out every pass, at most one pass
+//   behind, and the other jobs get their turn in between.
+//   Jobs report their progress, for the display or a log.
+//   Nothing allocates. Time comes from an injected microsecond clock (wrapping),
+//   so the host simulation can run it on a simulated one.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SCHED_MAX_TASKS 8
+#define SCHED_MAX_JOBS 8
+
+typedef uint32_t (*SchedClock)();
+
+class SlicedJob {
+  public:
+    enum State { IDLE, QUEUED, RUNNING, PUBLISHING };
+
+    virtual ~SlicedJob() {}
+
+    // Take the inputs and start over
+    virtual void Begin() = 0;
+    // One bounded piece of the work, true when it's all done
+    virtual bool Step() = 0;
+    // Hand the result over without blocking, false to be retried later
+    virtual bool Publish() = 0;
+    // How far the pass is: 0 after Begin(), rising with every Step(), 1 once
+    //   Step() has returned true
+    virtual float Progress() const = 0;
+
+    State JobState() const {
+        return state;
+    }
+
+    // Outside the scheduler (boot, before the main loop): all the work in one
+    //   go. False if Publish() refused.
+    bool RunNow() {
+        Begin();
+        while (!Step()) {
+        }
+        return Publish();
+    }
+
+  private:
+    friend class Scheduler;
+    State state = IDLE;
+    bool again = false;     // resubmitted while running, go again after publishing
+};
+
+class Scheduler {
+  public:
+    struct TaskStats {
+        const char* name;
+        uint32_t runs;
+        uint32_t worst_late_us;     // after its due time
+        uint32_t worst_run_us;
+    };
+
+    void Init(SchedClock c, uint32_t slice) {
+        clock = c;
+        slice_us = slice;
+        task_count = 0;
+        head = count = 0;
+        published = 0;
+    }
+
+    // The first run is one period from now
+    bool AddPeriodic(const char* name, void (*fn)(), uint32_t period_us) {
+        if (task_count == SCHED_MAX_TASKS) {
+            return false;
+        }
+        Task& t = tasks[task_count++];
+        t.fn = fn;
+        t.period = period_us;
+        t.due = clock() + period_us;
+        t.stats = { name, 0, 0, 0 };
+        return true;
+    }
+
+    // False if the queue is full
+    bool Submit(SlicedJob* job) {
+        if (job->state == SlicedJob::QUEUED) {
+            return true;
+        }
+        if (job->state != SlicedJob::IDLE) {
+            job->again = true;
+            return true;
+        }
+        if (count == SCHED_MAX_JOBS) {
+            return false;
+        }
+        queue[(head + count++) % SCHED_MAX_JOBS] = job;
+        job->state = SlicedJob::QUEUED;
+        return true;
+    }
+
+    // Run the periodic tasks that are due, then jobs for up to slice_us
+    void Poll() {
+        for (int i = 0; i < task_count; i++) {
+            Task& t = tasks[i];
+            const uint32_t now = clock();
+            if ((int32_t)(now - t.due) < 0) {
+                continue;
+            }
+            if (now - t.due > t.stats.worst_late_us) {
+                t.stats.worst_late_us = now - t.due;
+            }
+            t.fn();
+            const uint32_t end = clock();
+            if (end - now > t.stats.worst_run_us) {
+                t.stats.worst_run_us = end - now;
+            }
+            t.stats.runs++;
+            t.due += t.period;
+            if ((int32_t)(end - t.due) >= 0) {
+                t.due = end + t.period;     // missed runs are skipped
+            }
+        }
+
+        const uint32_t start = clock();
+        while (count > 0) {
+            SlicedJob* job = queue[head];
+            if (job->state == SlicedJob::QUEUED) {
+                job->Begin();
+                job->state = SlicedJob::RUNNING;
+            }
+            if (job->state == SlicedJob::RUNNING && job->Step()) {
+                job->state = SlicedJob::PUBLISHING;
+            }
+            if (job->state == SlicedJob::PUBLISHING) {
+                if (!job->Publish()) {
+                    break;      // the audio thread is still on the last one
+                }
+                head = (head + 1) % SCHED_MAX_JOBS;
+                published++;
+                if (job->again) {
+                    job->again = false;
+                    job->state = SlicedJob::QUEUED;     // the count stays, it's back at the tail
+                    queue[(head + count - 1) % SCHED_MAX_JOBS] = job;
+                } else {
+                    job->state = SlicedJob::IDLE;
+                    count--;
+                }
+            }
+            if (clock() - start >= slice_us) {
+                break;
+            }
+        }
+    }
+
+    // How long the caller can sleep: until the next task is due, 0 while
+    // there's job work left to do
+    uint32_t IdleUs() const {
+        if (count > 0 && queue[head]->state != SlicedJob::PUBLISHING) {
+            return 0;
+        }
+        const uint32_t now = clock();
+        uint32_t idle = UINT32_MAX;
+        for (int i = 0; i < task_count; i++) {
+            const int32_t left = (int32_t)(tasks[i].due - now);
+            if (left <= 0) {
+                return 0;
+            }
+            if ((uint32_t)left < idle) {
+                idle = left;
+            }
+        }
+        return idle == UINT32_MAX ? 0 : idle;
+    }
+
+    // Job at the head of the queue, null when there's none
+    const SlicedJob* Current() const {
+        return count > 0 ? queue[head] : nullptr;
+    }
+
+    uint32_t Published() const {
+        return published;
+    }
+
+    int TaskCount() const {
+        return task_count;
+    }
+
+    const TaskStats& Stats(int i) const {
+        return tasks[i].stats;
+    }
+
+  private:
+    struct Task {
+        void (*fn)();
+        uint32_t period;
+        uint32_t due;
+        TaskStats stats;
+    };
+
+    SchedClock clock;
+    uint32_t slice_us;
+    Task tasks[SCHED_MAX_TASKS];
+    int task_count;
+    SlicedJob* queue[SCHED_MAX_JOBS];
+    int head, count;
+    uint32_t published;
+};
@@ -0,0 +1,84 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Lock-free single producer / single consumer ring buffer
+//   For passing data from the audio callback to the main loop: the callback
+//   only pushes, the main loop only pops, neither ever waits. When the ring is
+//   full, Push() drops what doesn't fit instead of overwriting unread data.
+//   N must be a power of two; the indices run freely and wrap with the mask.
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+template <typename T, size_t N>
+class SpscRing {
+    static_assert((N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+  public:
+    // Producer. Returns how many items were stored.
+    size_t Push(const T* data, size_t n) {
+        const size_t w = write.load(std::memory_order_relaxed);
+        const size_t r = read.load(std::memory_order_acquire);
+        const size_t space = N - (w - r);
+        if (n > space) {
+            n = space;
+        }
+        for (size_t i = 0; i < n; i++) {
+            buf[(w + i) & (N - 1)] = data[i];
+        }
+        write.store(w + n, std::memory_order_release);
+        return n;
+    }
+
+    bool Push(const T& item) {
+        return Push(&item, 1) == 1;
+    }
+
+    // Consumer. Returns how many items were read.
+    size_t Pop(T* data, size_t n) {
+        const size_t r = read.load(std::memory_order_relaxed);
+        const size_t w = write.load(std::memory_order_acquire);
+        const size_t avail = w - r;
+        if (n > avail) {
+            n = avail;
+        }
+        for (size_t i = 0; i < n; i++) {
+            data[i] = buf[(r + i) & (N - 1)];
+        }
+        read.store(r + n, std::memory_order_release);
+        return n;
+    }
+
+    bool Pop(T& item) {
+        return Pop(&item, 1) == 1;
+    }
+
+    // Consumer: drop everything queued
+    void Clear() {
+        read.store(write.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    size_t Available() const {
+        return write.load(std::memory_order_acquire) - read.load(std::memory_order_relaxed);
+    }
+
+  private:
+    T buf[N];
+    std::atomic<size_t> write{0};
+    std::atomic<size_t> read{0};
+};
@@ -0,0 +1,252 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Tempo-synced two-tap delay
+//   The beat tap repeats on the tempo and feeds back through a band-limiting
+//   filter; the second tap sits at a fraction of the beat (2/3 triplet, 3/4
+//   dotted eighth) and doesn't feed back, like the old delay1 second tap.
+//   The buffer is long and lives in SDRAM, where scattered single reads are slow,
+//   so the delay only touches it in contiguous bursts: per block, each tap copies
+//   the span it will read into a staging buffer, and the block's writes are
+//   collected and copied out in one go. The per-sample work runs on the staging
+//   buffers (inline, in fast memory with the engine).
+//   That needs every tap to be longer than a block, which musical times are.
+//   Tempo changes glide (by at most a quarter block per block) so the read spans
+//   stay contiguous and there are no clicks.
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef MAX_BLOCK_SIZE
+#define MAX_BLOCK_SIZE 256
+#endif
+
+#define DELAY_MAX_SECONDS 2.0f
+#define DELAY_MEM_SIZE 96000            // DELAY_MAX_SECONDS at 48 kHz
+#define DELAY_MIN_SECONDS 0.1f
+#define DELAY_FEEDBACK 0.4f
+#define DELAY_LEVEL 0.5f
+#define DELAY_SECOND_TAP_LEVEL 0.7f     // relative to the beat tap
+#define DELAY_FB_LP_FREQ 3500.0f        // feedback path band, repeats get darker and thinner
+#define DELAY_FB_HP_FREQ 120.0f
+#define DELAY_STAGE_SIZE (MAX_BLOCK_SIZE + MAX_BLOCK_SIZE / 4 + 4)
+
+class TapDelay {
+  public:
+    // mem: DELAY_MEM_SIZE floats
+    void Init(float sr, float* mem) {
+        sample_rate = sr;
+        buf = mem;
+        write_pos = 0;
+        SetBeat(0.5f);
+        delay = target;
+        second_fraction = 0.0f;
+        enabled = false;
+        wet = 0.0f;
+        lp = hp_in = hp_out = 0.0f;
+        lp_coef = 1.0f - expf(-2.0f * (float)M_PI * DELAY_FB_LP_FREQ / sr);
+        hp_coef = expf(-2.0f * (float)M_PI * DELAY_FB_HP_FREQ / sr);
+        Reset();
+    }
+
+    // Control context: clears the whole buffer
+    void Reset() {
+        memset(buf, 0, DELAY_MEM_SIZE * sizeof(float));
+        lp = hp_in = hp_out = 0.0f;
+    }
+
+    // Beat length in seconds, clamped to what the buffer holds
+    void SetBeat(float seconds) {
+        if (seconds < DELAY_MIN_SECONDS) seconds = DELAY_MIN_SECONDS;
+        if (seconds > DELAY_MAX_SECONDS) seconds = DELAY_MAX_SECONDS;
+        float samples = seconds * sample_rate;
+        const float longest = (float)(DELAY_MEM_SIZE - 2 * DELAY_STAGE_SIZE);
+        target = samples < longest ? samples : longest;
+    }
+
+    float Beat() const {
+        return target / sample_rate;
+    }
+
+    // 0 = beat tap only, else the second tap's share of the beat (0.25..1)
+    void SetSecondTap(float fraction) {
+        if (fraction > 0.0f && fraction < 0.25f) fraction = 0.25f;
+        if (fraction > 1.0f) fraction = 1.0f;
+        second_fraction = fraction;
+    }
+
+    float SecondTap() const {
+        return second_fraction;
+    }
+
+    // Off fades the taps out; the dry signal keeps being recorded so turning
+    // it back on picks up the trails
+    void SetEnabled(bool on) {
+        enabled = on;
+    }
+
+    bool IsEnabled() const {
+        return enabled;
+    }
+
+    // In place, adds the echoes to io
+    void Process(float* io, size_t size) {
+        if (size == 0 || size > MAX_BLOCK_SIZE) {
+            return;
+        }
+        const float wet_target = enabled ? DELAY_LEVEL : 0.0f;
+        if (wet == 0.0f) {
+            delay = target;     // silent, no need to glide
+            if (wet_target == 0.0f) {
+                BurstWrite(io, size);
+                return;
+            }
+        }
+
+        // Glide towards the tapped tempo
+        const float d0 = delay;
+        const float max_step = 0.25f * (float)size;
+        float step = target - delay;
+        if (step > max_step) step = max_step;
+        if (step < -max_step) step = -max_step;
+        const float d1 = delay + step;
+        delay = d1;
+
+        const bool second = second_fraction > 0.0f;
+        Stage(0, d0, d1, size);
+        if (second) {
+            Stage(1, d0 * second_fraction, d1 * second_fraction, size);
+        }
+
+        const float wet_step = (wet_target - wet) / size;
+        float w = wet;
+        for (size_t i = 0; i < size; i++) {
+            const float x = io[i];
+            const float b = Tap(0, i);
+            float echo = b;
+            if (second) {
+                echo += DELAY_SECOND_TAP_LEVEL * Tap(1, i);
+            }
+
+            // Feedback: one-pole lowpass, then one-pole highpass
+            lp += lp_coef * (b - lp);
+            hp_out = hp_coef * (hp_out + lp - hp_in);
+            hp_in = lp;
+
+            write_stage[i] = x + DELAY_FEEDBACK * hp_out;
+            w += wet_step;
+            io[i] = x + w * echo;
+        }
+        wet = wet_target;
+        BurstWrite(write_stage, size);
+    }
+
+  private:
+    float sample_rate;
+    float* buf;                 // SDRAM
+    size_t write_pos;
+    float delay;                // beat length now, samples
+    float target;               // beat length tapped
+    float second_fraction;
+    bool enabled;
+    float wet;
+    float lp, hp_in, hp_out;
+    float lp_coef, hp_coef;
+
+    // Per-tap span of the buffer this block reads, and where it starts
+    float stage[2][DELAY_STAGE_SIZE];
+    float stage_base[2];        // sample i reads stage[t] at i + base - slope * (i + 1)
+    float stage_slope[2];
+    float write_stage[MAX_BLOCK_SIZE];
+
+    // Copy the span read by a tap whose delay goes from d0 to d1 over the block
+    void Stage(int t, float d0, float d1, size_t size) {
+        const float dmax = d0 > d1 ? d0 : d1;
+        const float dmin = d0 > d1 ? d1 : d0;
+        const long back = (long)dmax + 1;
+        const size_t len = size + (size_t)(dmax - dmin) + 3;
+
+        long start = (long)write_pos - back;
+        if (start < 0) {
+            start += DELAY_MEM_SIZE;
+        }
+        BurstRead(stage[t], (size_t)start, len);
+
+        stage_base[t] = (float)back - d0;
+        stage_slope[t] = (d1 - d0) / size;
+    }
+
+    // Linear interpolation inside a staged span
+    float Tap(int t, size_t i) const {
+        const float* s = stage[t];
+        const float pos = (float)i + stage_base[t] - stage_slope[t] * (float)(i + 1);
+        const size_t k = (size_t)pos;
+        const float frac = pos - (float)k;
+        return s[k] + frac * (s[k + 1] - s[k]);
+    }
+
+    void BurstRead(float* dst, size_t start, size_t len) {
+        const size_t first = DELAY_MEM_SIZE - start < len ? DELAY_MEM_SIZE - start : len;
+        memcpy(dst, &buf[start], first * sizeof(float));
+        memcpy(dst + first, buf, (len - first) * sizeof(float));
+    }
+
+    void BurstWrite(const float* src, size_t len) {
+        const size_t first = DELAY_MEM_SIZE - write_pos < len ? DELAY_MEM_SIZE - write_pos : len;
+        memcpy(&buf[write_pos], src, first * sizeof(float));
+        memcpy(buf, src + first, (len - first) * sizeof(float));
+        write_pos += len;
+        if (write_pos >= DELAY_MEM_SIZE) {
+            write_pos -= DELAY_MEM_SIZE;
+        }
+    }
+};
+
+// Tap tempo from footswitch presses: the beat is the average of the last
+//   two intervals (the first interval alone after two taps); a gap longer
+//   than the longest delay starts over.
+class TapTempo {
+  public:
+    // now_ms: any free running millisecond clock. True when a new beat is ready.
+    bool Tap(uint32_t now_ms) {
+        const uint32_t dt = now_ms - last_ms;
+        last_ms = now_ms;
+        if (!armed || dt > (uint32_t)(DELAY_MAX_SECONDS * 1000.0f) || dt < (uint32_t)(DELAY_MIN_SECONDS * 1000.0f)) {
+            armed = true;
+            intervals = 0;
+            return false;
+        }
+        beat_ms = intervals == 0 ? (float)dt : 0.5f * (float)(last_dt + dt);
+        last_dt = dt;
+        intervals++;
+        return true;
+    }
+
+    float BeatSeconds() const {
+        return beat_ms * 0.001f;
+    }
+
+  private:
+    uint32_t last_ms = 0;
+    bool armed = false;
+    int intervals = 0;
+    uint32_t last_dt = 0;       // the interval before this one
+    float beat_ms = 500.0f;
+};
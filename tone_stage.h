@@ -0,0 +1,170 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Tone stage: one state variable filter (Simper/Cytomic TPT SVF) for the whole
+//   Filter knob, replacing Tone/ATone + Balance.
+//   Knob 0..0.5 is a lowpass sweeping 100 Hz..20 kHz, 0.5..1 a highpass sweeping
+//   40..440 Hz, the same ranges as before. The output is a mix of the SVF taps,
+//     out = gain * (m0 * x + m1 * band + m2 * low)
+//   and near the knob center the mix morphs to flat (m0 = 1), so crossing from
+//   lowpass to highpass needs no switch and the filter state carries on.
+//   The level compensation is computed with the coefficients instead of
+//   tracking envelopes: the power gain of a Butterworth response averaged over
+//   a pink spectrum (equal weight per octave, 20 Hz..20 kHz) has a closed form,
+//   and its inverse square root is what Balance would settle to on such a signal.
+//   Coefficients are recomputed only when the knob moves and ramped across one block.
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+
+#define TONE_Q_K        1.41421356f     // k = 1/Q, Butterworth
+#define TONE_MORPH_BAND 0.05f           // knob distance from center over which the filter fades in
+#define TONE_MAX_COMP   4.0f            // +12 dB at most
+#define TONE_REF_LO     20.0f           // pink reference band for the level compensation
+#define TONE_REF_HI     20000.0f
+
+class ToneStage {
+  public:
+    void Init(float sr) {
+        sample_rate = sr;
+        ic1eq = ic2eq = 0.0f;
+        knob = -1.0f;
+        Compute(0.5f, cur);
+        tgt = cur;
+    }
+
+    // Control rate, once per block
+    void SetFilter(float v) {
+        if (fabsf(v - knob) < 0.0001f) {
+            return;
+        }
+        knob = v;
+        Compute(v, tgt);
+    }
+
+    // In place, coefficients ramp from the last block's to the current target
+    void Process(float* buf, size_t size) {
+        if (size == 0) {
+            return;
+        }
+        const float inv = 1.0f / size;
+        Coefs d;
+        d.a1 = (tgt.a1 - cur.a1) * inv;
+        d.a2 = (tgt.a2 - cur.a2) * inv;
+        d.a3 = (tgt.a3 - cur.a3) * inv;
+        d.m0 = (tgt.m0 - cur.m0) * inv;
+        d.m1 = (tgt.m1 - cur.m1) * inv;
+        d.m2 = (tgt.m2 - cur.m2) * inv;
+
+        Coefs c = cur;
+        float s1 = ic1eq, s2 = ic2eq;
+        for (size_t i = 0; i < size; i++) {
+            c.a1 += d.a1;
+            c.a2 += d.a2;
+            c.a3 += d.a3;
+            c.m0 += d.m0;
+            c.m1 += d.m1;
+            c.m2 += d.m2;
+
+            const float x = buf[i];
+            const float v3 = x - s2;
+            const float v1 = c.a1 * s1 + c.a2 * v3;
+            const float v2 = s2 + c.a2 * s1 + c.a3 * v3;
+            s1 = 2.0f * v1 - s1;
+            s2 = 2.0f * v2 - s2;
+            buf[i] = c.m0 * x + c.m1 * v1 + c.m2 * v2;
+        }
+        ic1eq = s1;
+        ic2eq = s2;
+        cur = tgt;
+    }
+
+    // Same sound, per sample (cost probes). No ramp.
+    float Process(float x) {
+        const float v3 = x - ic2eq;
+        const float v1 = cur.a1 * ic1eq + cur.a2 * v3;
+        const float v2 = ic2eq + cur.a2 * ic1eq + cur.a3 * v3;
+        ic1eq = 2.0f * v1 - ic1eq;
+        ic2eq = 2.0f * v2 - ic2eq;
+        return cur.m0 * x + cur.m1 * v1 + cur.m2 * v2;
+    }
+
+  private:
+    // SVF coefficients plus output mix, level compensation folded into m0..m2
+    struct Coefs {
+        float a1, a2, a3;
+        float m0, m1, m2;
+    };
+
+    float sample_rate;
+    float knob;
+    float ic1eq, ic2eq;
+    Coefs cur, tgt;
+
+    void Compute(float v, Coefs& c) {
+        const bool lowpass = v <= 0.5f;
+        float fc = lowpass ? v * 39800.0f + 100.0f : (v - 0.5f) * 800.0f + 40.0f;
+        if (fc > 0.45f * sample_rate) {
+            fc = 0.45f * sample_rate;
+        }
+
+        const float g = tanf((float)M_PI * fc / sample_rate);
+        c.a1 = 1.0f / (1.0f + g * (g + TONE_Q_K));
+        c.a2 = g * c.a1;
+        c.a3 = g * c.a2;
+
+        // 0 at the center (flat), 1 once the knob is TONE_MORPH_BAND away
+        float a = fabsf(v - 0.5f) / TONE_MORPH_BAND;
+        if (a > 1.0f) {
+            a = 1.0f;
+        }
+        a = a * a * (3.0f - 2.0f * a);
+
+        const float lpPower = LowpassPinkPower(fc);
+        const float power = lowpass ? lpPower : 1.0f - lpPower;
+        float comp = power > 1.0f / (TONE_MAX_COMP * TONE_MAX_COMP) ? 1.0f / sqrtf(power) : TONE_MAX_COMP;
+        comp = 1.0f + a * (comp - 1.0f);
+
+        // out = x + a * (filtered - x), low = v2, band = v1, high = x - k * band - low
+        if (lowpass) {
+            c.m0 = comp * (1.0f - a);
+            c.m1 = 0.0f;
+            c.m2 = comp * a;
+        } else {
+            c.m0 = comp;
+            c.m1 = -comp * a * TONE_Q_K;
+            c.m2 = -comp * a;
+        }
+    }
+
+    // Mean of |H|^2 = 1 / (1 + (f/fc)^4) over log frequency in the reference band.
+    //   With t = ln(f/fc): integral of 1 / (1 + e^4t) dt = t - ln(1 + e^4t) / 4
+    //   The highpass is 1 - lowpass for a Butterworth pair.
+    static float LowpassPinkPower(float fc) {
+        const float t1 = logf(TONE_REF_LO / fc);
+        const float t2 = logf(TONE_REF_HI / fc);
+        return (Primitive(t2) - Primitive(t1)) / (t2 - t1);
+    }
+
+    static float Primitive(float t) {
+        // ln(1 + e^4t) without overflow for large t
+        const float x = 4.0f * t;
+        const float softplus = x > 20.0f ? x : log1pf(expf(x));
+        return t - 0.25f * softplus;
+    }
+};
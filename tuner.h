@@ -0,0 +1,272 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Tuner
+//   Split in two so the audio interrupt does almost nothing:
+//   - TunerFeed runs in the callback: two one-pole lowpasses and keeping every
+//     Nth sample, down to ~12 kHz, pushed into a lock-free ring once per block.
+//   - Tuner runs in the main loop: it drains the ring into a window and, every
+//     TUNER_HOP new samples, runs the McLeod pitch method (MPM) on it. The
+//     autocorrelation for the normalized square difference function comes from
+//     an FFT (|X|^2, inverse FFT), the rest is a single pass over the lags.
+//   Range 30 Hz (low B on a 5-string bass) to 1 kHz.
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+
+#include "spsc_ring.h"
+#include "ImpulseResponse/fft.h"
+
+#define TUNER_TARGET_RATE 12000.0f
+#define TUNER_LP_FREQ 1500.0f
+#define TUNER_RING_SIZE 2048            // ~0.17 s at the tuner rate
+#define TUNER_WINDOW 1024
+#define TUNER_FFT_SIZE (2 * TUNER_WINDOW)
+#define TUNER_HOP 256
+#define TUNER_MIN_FREQ 30.0f
+#define TUNER_MAX_FREQ 1000.0f
+#define TUNER_MIN_RMS 0.003f            // below this there's no note
+#define TUNER_MIN_CLARITY 0.7f          // NSDF peak needed to trust a pitch
+#define TUNER_PEAK_RATIO 0.9f           // MPM: first key maximum within this of the highest
+#define TUNER_IN_TUNE_CENTS 3.0f
+
+typedef SpscRing<float, TUNER_RING_SIZE> TunerRing;
+
+// Audio callback side
+class TunerFeed {
+  public:
+    void Init(float sr, TunerRing* r) {
+        ring = r;
+        factor = (int)(sr / TUNER_TARGET_RATE + 0.5f);
+        if (factor < 1) {
+            factor = 1;
+        }
+        rate = sr / factor;
+        coef = 1.0f - expf(-2.0f * (float)M_PI * TUNER_LP_FREQ / sr);
+        lp1 = lp2 = 0.0f;
+        phase = 0;
+    }
+
+    // Rate of the samples in the ring
+    float Rate() const {
+        return rate;
+    }
+
+    void Process(const float* in, size_t size) {
+        float out[TUNER_RING_SIZE / 8];
+        size_t k = 0;
+        for (size_t i = 0; i < size; i++) {
+            lp1 += coef * (in[i] - lp1);
+            lp2 += coef * (lp1 - lp2);
+            if (++phase == factor) {
+                phase = 0;
+                out[k++] = lp2;
+                if (k == sizeof(out) / sizeof(out[0])) {
+                    ring->Push(out, k);
+                    k = 0;
+                }
+            }
+        }
+        ring->Push(out, k);
+    }
+
+  private:
+    TunerRing* ring;
+    int factor;
+    int phase;
+    float rate;
+    float coef;
+    float lp1, lp2;
+};
+
+// Main loop side
+class Tuner {
+  public:
+    void Init(float rate, TunerRing* r) {
+        ring = r;
+        sample_rate = rate;
+        Reset();
+    }
+
+    // Forget the window and anything queued (when the tuner is switched on)
+    void Reset() {
+        ring->Clear();
+        for (size_t i = 0; i < TUNER_WINDOW; i++) {
+            window[i] = 0.0f;
+        }
+        fresh = 0;
+        valid = false;
+        freq = 0.0f;
+    }
+
+    // Drain the ring; true when a new estimate was computed
+    bool Update() {
+        float chunk[TUNER_HOP];
+        bool updated = false;
+        size_t n;
+        while ((n = ring->Pop(chunk, TUNER_HOP - fresh)) > 0) {
+            // Slide the window and append
+            for (size_t i = 0; i + n < TUNER_WINDOW; i++) {
+                window[i] = window[i + n];
+            }
+            for (size_t i = 0; i < n; i++) {
+                window[TUNER_WINDOW - n + i] = chunk[i];
+            }
+            fresh += n;
+            if (fresh >= TUNER_HOP) {
+                fresh = 0;
+                Analyse();
+                updated = true;
+            }
+        }
+        return updated;
+    }
+
+    // Last estimate
+    bool Valid() const { return valid; }
+    float Frequency() const { return freq; }
+    int Note() const { return note; }           // MIDI note number
+    float Cents() const { return cents; }       // -50..50 from Note()
+    bool InTune() const { return valid && fabsf(cents) < TUNER_IN_TUNE_CENTS; }
+
+  private:
+    TunerRing* ring;
+    float sample_rate;
+    float window[TUNER_WINDOW];
+    size_t fresh;
+
+    float re[TUNER_FFT_SIZE];
+    float im[TUNER_FFT_SIZE];
+
+    bool valid;
+    float freq;
+    int note;
+    float cents;
+
+    void Analyse() {
+        // DC removed copy, zero padded to twice the window so the circular
+        // autocorrelation equals the linear one
+        float mean = 0.0f;
+        for (size_t i = 0; i < TUNER_WINDOW; i++) {
+            mean += window[i];
+        }
+        mean /= TUNER_WINDOW;
+        float energy = 0.0f;
+        for (size_t i = 0; i < TUNER_FFT_SIZE; i++) {
+            re[i] = i < TUNER_WINDOW ? window[i] - mean : 0.0f;
+            im[i] = 0.0f;
+            energy += re[i] * re[i];
+        }
+        if (sqrtf(energy / TUNER_WINDOW) < TUNER_MIN_RMS) {
+            valid = false;
+            return;
+        }
+
+        FFT(re, im, TUNER_FFT_SIZE, false);
+        for (size_t k = 0; k < TUNER_FFT_SIZE; k++) {
+            re[k] = re[k] * re[k] + im[k] * im[k];
+            im[k] = 0.0f;
+        }
+        FFT(re, im, TUNER_FFT_SIZE, true);
+        // re[tau] * (1/N) is now r(tau)
+
+        // NSDF(tau) = 2 r(tau) / m(tau), m(tau) = sum of x[j]^2 + x[j + tau]^2 over the overlap.
+        // The window is re-read for m, re holds r.
+        const size_t tau_min = (size_t)(sample_rate / TUNER_MAX_FREQ);
+        size_t tau_max = (size_t)(sample_rate / TUNER_MIN_FREQ);
+        if (tau_max > TUNER_WINDOW / 2) {
+            tau_max = TUNER_WINDOW / 2;
+        }
+        const float scale = 1.0f / TUNER_FFT_SIZE;
+        float m = 2.0f * energy;
+        float prev = 1.0f;
+        // Reuse im[] for the NSDF
+        for (size_t tau = 0; tau <= tau_max + 1; tau++) {
+            if (tau > 0) {
+                const float a = window[tau - 1] - mean;
+                const float b = window[TUNER_WINDOW - tau] - mean;
+                m -= a * a + b * b;
+            }
+            im[tau] = m > 0.0f ? 2.0f * re[tau] * scale / m : 0.0f;
+        }
+
+        // Key maxima: the highest point of each positive lobe after the first
+        // negative-going zero crossing
+        float best = 0.0f;
+        size_t keys[64];
+        size_t key_count = 0;
+        bool in_lobe = false;
+        size_t lobe_max = 0;
+        bool started = false;
+        for (size_t tau = 1; tau <= tau_max; tau++) {
+            const float v = im[tau];
+            if (!started) {
+                started = prev > 0.0f && v <= 0.0f;
+            } else if (!in_lobe && prev <= 0.0f && v > 0.0f) {
+                in_lobe = true;
+                lobe_max = tau;
+            } else if (in_lobe && prev > 0.0f && v <= 0.0f) {
+                in_lobe = false;
+                if (key_count < 64) keys[key_count++] = lobe_max;
+            }
+            if (in_lobe && v > im[lobe_max]) {
+                lobe_max = tau;
+            }
+            prev = v;
+        }
+        if (in_lobe && key_count < 64) {
+            keys[key_count++] = lobe_max;
+        }
+        for (size_t k = 0; k < key_count; k++) {
+            if (im[keys[k]] > best) best = im[keys[k]];
+        }
+        if (key_count == 0 || best < TUNER_MIN_CLARITY) {
+            valid = false;
+            return;
+        }
+
+        size_t tau = keys[0];
+        for (size_t k = 0; k < key_count; k++) {
+            if (im[keys[k]] >= TUNER_PEAK_RATIO * best) {
+                tau = keys[k];
+                break;
+            }
+        }
+        if (tau < tau_min) {
+            valid = false;
+            return;
+        }
+
+        // Peak between lags: a parabola through the log values (Gaussian fit) is
+        // less biased than through the values at the short lags of high notes
+        float y0 = im[tau - 1], y1 = im[tau], y2 = im[tau + 1];
+        if (y0 > 0.0f && y2 > 0.0f) {
+            y0 = logf(y0);
+            y1 = logf(y1);
+            y2 = logf(y2);
+        }
+        const float denom = y0 - 2.0f * y1 + y2;
+        const float shift = denom != 0.0f ? 0.5f * (y0 - y2) / denom : 0.0f;
+        freq = sample_rate / ((float)tau + shift);
+
+        const float midi = 69.0f + 12.0f * log2f(freq / 440.0f);
+        note = (int)floorf(midi + 0.5f);
+        cents = 100.0f * (midi - note);
+        valid = true;
+    }
+};
@@ -0,0 +1,113 @@
+// Altair for Hothouse DIY DSP Platform
+// Copyright (C) 2024 ajg <green@jee.org.ua>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Lite amp model: Wiener-Hammerstein block model distilled from a GRU snapshot
+//   pre-filter (biquads) -> static waveshaper (table) -> post-filter (biquads)
+//   Fitted offline by host/wh_distill (`make wh-distill`) to the amp output,
+//   GRU plus the engine's dry skip path: the GRUs learn "amp minus input", which
+//   no block model can follow. Process() takes the input back out, so it stands
+//   in for the GRU's forward() and the engine adds the skip path and levelAdjust
+//   the same way. Around 35 operations per sample
+//   with no transcendentals, against a few hundred MACs and 27 tanh/sigmoid
+//   for GRU 9. No memory beyond the filter states, so no sag or bias drift;
+//   the fit reports how far that is from the GRU (ESR).
+//   Processed a block at a time, one pass per biquad with its coefficients in
+//   registers and one pass for the shaper. The Cortex-M7 has no float SIMD, so
+//   the shaper lookup is kept branch-free (clamp, truncate, lerp) instead.
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#define WH_PRE_SECTIONS 2
+#define WH_POST_SECTIONS 3
+#define WH_TABLE_SIZE 257
+
+struct WhLiteData {
+    float pre[WH_PRE_SECTIONS][5];      // biquads { b0, b1, b2, a1, a2 }
+    float post[WH_POST_SECTIONS][5];
+    float range;                        // the table spans -range..range, held at the ends outside
+    float table[WH_TABLE_SIZE];
+    float esr;                          // error-to-signal ratio against the GRU on held-out audio
+};
+
+class WhLite {
+  public:
+    // Runs from the caller's data, which must outlive it: the engine's own copy in
+    //   DTCM (EngineWeights), or the model table itself for engines sharing it
+    void Load(const WhLiteData& d) {
+        data = &d;
+        offset = d.range;
+        scale = d.range > 0.0f ? (WH_TABLE_SIZE - 1) / (2.0f * d.range) : 0.0f;
+        Reset();
+    }
+
+    void Reset() {
+        memset(preState, 0, sizeof(preState));
+        memset(postState, 0, sizeof(postState));
+    }
+
+    // Same contract as ProcessAmpModel(): out is the model output without the skip path
+    void Process(const float* in, float* out, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            out[i] = in[i];
+        }
+        for (int s = 0; s < WH_PRE_SECTIONS; s++) {
+            Biquad(data->pre[s], preState[s], out, size);
+        }
+
+        // The segment index stops one short of the top, which then lerps to frac 1
+        const float* table = data->table;
+        const float top = (float)(WH_TABLE_SIZE - 1);
+        for (size_t i = 0; i < size; i++) {
+            const float pos = fminf(fmaxf((out[i] + offset) * scale, 0.0f), top);
+            const int k = (int)fminf(pos, top - 1.0f);
+            const float frac = pos - k;
+            out[i] = table[k] + frac * (table[k + 1] - table[k]);
+        }
+
+        for (int s = 0; s < WH_POST_SECTIONS; s++) {
+            Biquad(data->post[s], postState[s], out, size);
+        }
+        for (size_t i = 0; i < size; i++) {
+            out[i] -= in[i];    // the engine adds it back
+        }
+    }
+
+  private:
+    const WhLiteData* data = nullptr;
+    float preState[WH_PRE_SECTIONS][2];
+    float postState[WH_POST_SECTIONS][2];
+    float offset;
+    float scale;
+
+    // Transposed direct form II, in place over the block
+    static void Biquad(const float* c, float* z, float* buf, size_t size) {
+        const float b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+        float z0 = z[0], z1 = z[1];
+        for (size_t i = 0; i < size; i++) {
+            const float x = buf[i];
+            const float y = b0 * x + z0;
+            z0 = b1 * x - a1 * y + z1;
+            z1 = b2 * x - a2 * y;
+            buf[i] = y;
+        }
+        z[0] = z0;
+        z[1] = z1;
+    }
+};
@@ -0,0 +1,185 @@
+// Lite amp models, generated by host/wh_distill from all_model_data_gru9_4count.h (`make wh-distill`), don't edit.
+// ModelNLite is distilled from ModelN. ESR against the GRU on held-out plucks
+// (under 0.02 close, under 0.10 a fallback for when the GRU doesn't fit, no table
+// is written for the others):
+//   Model 1: 0.0994, fallback
+//   Model 2: 0.4377, keep the GRU
+//   Model 3: 0.0538, fallback
+//   Model 4: 0.3132, keep the GRU
+//   Model 5: 0.6299, keep the GRU
+//   Model 6: 0.0562, fallback
+//   Model 7: 0.0568, fallback
+//   Model 8: 0.1204, keep the GRU
+
+#pragma once
+
+#include "wh_lite.h"
+
+const WhLiteData Model1Lite = {
+    { { 0.998159409, -1.99631882, 0.998159409, -1.99631536, 0.996322215 }, { 0.870354712, -1.44430804, 0.59244138, -1.44430804, 0.462796062 } },
+    { { 0.0196002945, 0.0392005891, 0.0196002945, -1.67606628, 0.754467487 }, { 1.00090551, -1.99986959, 0.998972476, -1.99986959, 0.999878049 }, { 0.995256305, -1.89110899, 0.958746016, -1.89110899, 0.954002321 } },
+    0.668800294,
+    {
+        1.17228937, 1.0749203, 0.977599025, 0.881438136, 0.787550271, 0.697047889, 0.611043632, 0.53065002,
+        0.456979632, 0.391144991, 0.334258676, 0.287419587, 0.250907034, 0.223730117, 0.204788566, 0.192982152,
+        0.187210649, 0.18637383, 0.189371437, 0.195103258, 0.202469051, 0.210368603, 0.217763841, 0.224339709,
+        0.230247572, 0.235646546, 0.240695775, 0.245554373, 0.2503815, 0.255336285, 0.260577828, 0.266265303,
+        0.272557795, 0.279563397, 0.287185729, 0.295277387, 0.30369091, 0.312278897, 0.320893884, 0.329388469,
+        0.337615192, 0.345426649, 0.352675378, 0.359216094, 0.365029067, 0.370289445, 0.375189096, 0.379919946,
+        0.384673804, 0.389642596, 0.39501819, 0.400992453, 0.407757252, 0.415504515, 0.424388468, 0.434126288,
+        0.44415313, 0.453899443, 0.462795645, 0.470272213, 0.475759566, 0.478688151, 0.478488445, 0.474590868,
+        0.466425896, 0.453713208, 0.43732965, 0.418441385, 0.398214459, 0.377815038, 0.358409226, 0.341163129,
+        0.327242881, 0.317814589, 0.314044356, 0.317082375, 0.327121884, 0.342872977, 0.362918079, 0.385839731,
+        0.410220385, 0.434642494, 0.45768857, 0.477941066, 0.493982494, 0.504395306, 0.507895589, 0.504753172,
+        0.496240109, 0.483645201, 0.468257248, 0.451365024, 0.434257388, 0.418223083, 0.40455094, 0.39452976,
+        0.389448315, 0.390187889, 0.39599973, 0.405727506, 0.418214917, 0.432305694, 0.446843475, 0.460671961,
+        0.472634882, 0.481575936, 0.486338794, 0.485778987, 0.479462504, 0.468056411, 0.452322602, 0.433022887,
+        0.41091907, 0.38677302, 0.361346602, 0.335401595, 0.309699863, 0.285003245, 0.261996776, 0.240473121,
+        0.219649091, 0.198731929, 0.176928893, 0.153447226, 0.127494156, 0.098276943, 0.0650028214, 0.0268790517,
+        -0.0168871321, -0.066685915, -0.121297203, -0.179098338, -0.238466635, -0.297779471, -0.355414152, -0.409748018,
+        -0.459158421, -0.502022684, -0.53671819, -0.561641634, -0.576355696, -0.582230031, -0.580789924, -0.573560476,
+        -0.562066793, -0.547834158, -0.532387674, -0.517252505, -0.503953874, -0.494016886, -0.488858014, -0.488630027,
+        -0.492670447, -0.500303149, -0.510851979, -0.523640931, -0.537993789, -0.553234518, -0.568687022, -0.583675146,
+        -0.597522855, -0.609721601, -0.620433927, -0.629989803, -0.63871938, -0.646952689, -0.65501976, -0.663250685,
+        -0.671975613, -0.681524575, -0.692227602, -0.704409778, -0.718093932, -0.73283428, -0.748144925, -0.763539851,
+        -0.778533041, -0.792638659, -0.80537051, -0.816242814, -0.824769497, -0.830464542, -0.832897186, -0.832278192,
+        -0.829232156, -0.824390531, -0.818384826, -0.811846614, -0.805407405, -0.799698591, -0.795351803, -0.792998433,
+        -0.793270051, -0.79656446, -0.802344322, -0.809838772, -0.818276763, -0.82688731, -0.834899485, -0.841542304,
+        -0.846044838, -0.847635984, -0.845544875, -0.83901155, -0.827936053, -0.813241839, -0.79594022, -0.777042508,
+        -0.757560074, -0.738504291, -0.720886528, -0.7057181, -0.694010377, -0.686774731, -0.684924126, -0.688228428,
+        -0.695719779, -0.706418157, -0.719343424, -0.733515501, -0.747954369, -0.761679947, -0.773712099, -0.783070803,
+        -0.788775921, -0.790310562, -0.789009929, -0.786672592, -0.785096884, -0.786081254, -0.791424096, -0.802923918,
+        -0.822379053, -0.851588011, -0.892349124, -0.94644165, -1.01448953, -1.0953263, -1.18763125, -1.290084,
+        -1.40136397, -1.52015054, -1.64512324, -1.77496147, -1.90834463, -2.04395223, -2.18052697, -2.31754422,
+        -2.45495248, -2.59270883, -2.7307694, -2.8690908, -3.00762939, -3.14634204, -3.2851851, -3.42411518,
+        -3.56308866
+    },
+    0.0994462
+};
+
+const WhLiteData Model3Lite = {
+    { { 0.992733002, -1.985466, 0.992733002, -1.98544586, 0.98548615 }, { 1.34359837, -1.80403376, 0.475986451, -1.80403376, 0.819584787 } },
+    { { 0.00712478952, 0.014249579, 0.00712478952, -1.64388013, 0.672379255 }, { 1.14731538, -1.47666609, 0.472162277, -1.47666609, 0.619477689 }, { 0.912881494, 1.72524405, 0.901147485, 1.72524405, 0.814028978 } },
+    3.02208996,
+    {
+        0.748344779, 0.743221462, 0.738142431, 0.733145237, 0.728267491, 0.723546922, 0.719021022, 0.714727581,
+        0.710704088, 0.706988275, 0.703617692, 0.700629592, 0.698038578, 0.695823848, 0.69396168, 0.69242835,
+        0.691200018, 0.690253019, 0.689563632, 0.689108014, 0.688862443, 0.688803196, 0.688904643, 0.689119875,
+        0.689387918, 0.689647853, 0.689838588, 0.689899087, 0.689768314, 0.689385176, 0.688688636, 0.68761766,
+        0.686111212, 0.68415004, 0.681882143, 0.679497421, 0.677185655, 0.675136626, 0.673540294, 0.672586381,
+        0.672464788, 0.673365355, 0.675477803, 0.678988278, 0.683852971, 0.689672291, 0.696015775, 0.702453196,
+        0.708554149, 0.713888288, 0.718025267, 0.720534861, 0.720986545, 0.718950152, 0.714057386, 0.706662178,
+        0.697584271, 0.687651396, 0.677691042, 0.668530822, 0.660998344, 0.655921102, 0.654126763, 0.65644294,
+        0.663697124, 0.676325858, 0.693201244, 0.712804496, 0.733616531, 0.754118443, 0.772791386, 0.788116336,
+        0.798574448, 0.802646697, 0.798814237, 0.78558284, 0.762942731, 0.733185232, 0.698799491, 0.662274659,
+        0.626099825, 0.592764258, 0.564757049, 0.544567406, 0.53468442, 0.537597299, 0.555499792, 0.587151468,
+        0.62909627, 0.677841246, 0.729893506, 0.781759977, 0.82994777, 0.870963991, 0.90131557, 0.917509615,
+        0.916053116, 0.894758582, 0.85665977, 0.806095898, 0.747406244, 0.684930027, 0.623006344, 0.565974534,
+        0.518173754, 0.483943194, 0.467622131, 0.473492771, 0.502418995, 0.549966216, 0.611244082, 0.681362212,
+        0.755430162, 0.828557611, 0.895854235, 0.952429593, 0.993393302, 1.0138551, 1.00929391, 0.979484677,
+        0.926973283, 0.854351997, 0.764212966, 0.659148455, 0.541750669, 0.414611876, 0.280324221, 0.141479924,
+        0.000671231363, -0.139545277, -0.276755542, -0.408581108, -0.532643557, -0.646564364, -0.747965217, -0.83446753,
+        -0.90369302, -0.953263044, -0.980799317, -0.983967245, -0.963064075, -0.922466576, -0.86690253, -0.801099479,
+        -0.729785204, -0.657687366, -0.589533627, -0.530051708, -0.483969241, -0.456013918, -0.450474828, -0.466542184,
+        -0.500116587, -0.54704386, -0.603169858, -0.664340258, -0.726400912, -0.785197675, -0.836576343, -0.876382649,
+        -0.900462389, -0.905900478, -0.89473778, -0.870254278, -0.835729957, -0.79444474, -0.749678671, -0.704711616,
+        -0.662823617, -0.6272946, -0.601404548, -0.588398218, -0.589408457, -0.602294624, -0.624634445, -0.654005766,
+        -0.687986314, -0.724153876, -0.760086179, -0.793361008, -0.821556151, -0.842249334, -0.853218198, -0.854562819,
+        -0.847881734, -0.834798634, -0.81693697, -0.795920312, -0.773372233, -0.750916302, -0.730176032, -0.712775052,
+        -0.700336814, -0.694056869, -0.693418324, -0.697476208, -0.705285668, -0.715901673, -0.728379309, -0.741773665,
+        -0.755139709, -0.767532587, -0.778007329, -0.785627723, -0.789981484, -0.791468501, -0.790558577, -0.787721455,
+        -0.783426821, -0.778144419, -0.772343993, -0.766495347, -0.761068165, -0.756532252, -0.753324986, -0.751508355,
+        -0.750902116, -0.751321912, -0.752583444, -0.754502356, -0.75689441, -0.759575248, -0.762360573, -0.765066028,
+        -0.767507374, -0.769540191, -0.771180153, -0.772482753, -0.773503661, -0.774298429, -0.774922669, -0.775431931,
+        -0.775881767, -0.776327789, -0.776825666, -0.777430296, -0.77816534, -0.779005349, -0.779920816, -0.78088218,
+        -0.781859815, -0.782824278, -0.783745885, -0.784595132, -0.785342455, -0.78595829, -0.786415279, -0.78671205,
+        -0.786863804, -0.786886096, -0.786794484, -0.786604583, -0.786331832, -0.785991788, -0.785600066, -0.785172224,
+        -0.784723699
+    },
+    0.0537915
+};
+
+const WhLiteData Model6Lite = {
+    { { 0.99634403, -1.99268806, 0.99634403, -1.99267685, 0.992699206 }, { 1.12816083, -1.57197917, 0.507100761, -1.57197917, 0.635261595 } },
+    { { 0.0322878063, 0.0645756125, 0.0322878063, -1.44532204, 0.574473321 }, { 1.00050139, -1.99562609, 0.995763123, -1.99562609, 0.996264577 }, { 0.998690367, -1.98097599, 0.987707675, -1.98097599, 0.986398041 } },
+    1.20166183,
+    {
+        -0.5276106, -0.529408634, -0.531207442, -0.533007503, -0.534809649, -0.536614537, -0.538422763, -0.540235043,
+        -0.54205209, -0.543874562, -0.545703113, -0.547540307, -0.54950124, -0.551875472, -0.554967403, -0.559081674,
+        -0.564522803, -0.571595252, -0.5806036, -0.591852367, -0.605646074, -0.62228924, -0.642033875, -0.664521873,
+        -0.689001381, -0.71471411, -0.740901709, -0.766805708, -0.791667819, -0.814729691, -0.835232913, -0.852419138,
+        -0.865530014, -0.874075174, -0.878636479, -0.880063713, -0.879206717, -0.876915336, -0.874039412, -0.871428728,
+        -0.869933188, -0.870402515, -0.873686671, -0.880623817, -0.891359329, -0.904964566, -0.920418322, -0.93669945,
+        -0.952786922, -0.967659593, -0.980296314, -0.989675939, -0.994777441, -0.994579673, -0.988163829, -0.975801647,
+        -0.958532691, -0.937409401, -0.913484097, -0.887809277, -0.861437261, -0.835420549, -0.81081146, -0.788662434,
+        -0.770025909, -0.755682886, -0.745329022, -0.738388598, -0.734285951, -0.7324453, -0.732290983, -0.733247221,
+        -0.73473835, -0.73618871, -0.737022519, -0.7366696, -0.734894872, -0.731982052, -0.728259802, -0.724056602,
+        -0.719701052, -0.715521514, -0.711846709, -0.709005058, -0.707325161, -0.707135499, -0.708730817, -0.712012589,
+        -0.716628492, -0.722222209, -0.728437185, -0.734916985, -0.741305172, -0.747245252, -0.752380848, -0.756355345,
+        -0.758812428, -0.759501219, -0.7585935, -0.756366611, -0.753098011, -0.749065042, -0.744545102, -0.739815593,
+        -0.735153973, -0.730837524, -0.727143764, -0.724343538, -0.722320735, -0.720359385, -0.717691898, -0.713550508,
+        -0.707167745, -0.697775841, -0.684607208, -0.666894257, -0.64386934, -0.61476481, -0.578894198, -0.536514163,
+        -0.488490075, -0.435697258, -0.379011154, -0.319307119, -0.257460624, -0.194347039, -0.130841762, -0.0678201988,
+        -0.00615775678, 0.0533607006, 0.110312477, 0.164365441, 0.215187415, 0.262446254, 0.305809826, 0.344945997,
+        0.379522562, 0.409207404, 0.433668375, 0.452579409, 0.465981722, 0.474485517, 0.47875008, 0.479434609,
+        0.477198362, 0.472700566, 0.466600448, 0.459557235, 0.452230155, 0.445278436, 0.439319938, 0.434491038,
+        0.430617601, 0.427520245, 0.425019652, 0.42293644, 0.421091288, 0.419304878, 0.417397797, 0.415190756,
+        0.412504375, 0.409220427, 0.405465126, 0.401425719, 0.397289515, 0.39324379, 0.389475882, 0.38617301,
+        0.38352254, 0.381711721, 0.380927861, 0.381355494, 0.383013517, 0.385664165, 0.389047593, 0.392903924,
+        0.396973312, 0.40099588, 0.404711783, 0.407861173, 0.410184175, 0.411420941, 0.411355585, 0.410283625,
+        0.408830494, 0.407627136, 0.407304466, 0.408493429, 0.411824942, 0.417929947, 0.427439362, 0.44098413,
+        0.459195167, 0.482415169, 0.509833813, 0.540352464, 0.572872519, 0.606295407, 0.639522552, 0.671455324,
+        0.700995207, 0.72704345, 0.748501599, 0.764281988, 0.773953855, 0.778104901, 0.777410269, 0.772545159,
+        0.764184892, 0.753004491, 0.739679277, 0.72488445, 0.709295213, 0.693586767, 0.678384602, 0.663737416,
+        0.649321377, 0.634806633, 0.619863331, 0.604161441, 0.587371111, 0.569162428, 0.549205542, 0.52717042,
+        0.502727211, 0.475809187, 0.447401971, 0.418754488, 0.391115546, 0.365734011, 0.343858719, 0.326738536,
+        0.3156223, 0.311758876, 0.316397101, 0.330774397, 0.355443805, 0.389897525, 0.43353644, 0.485761493,
+        0.545973599, 0.61357373, 0.68796277, 0.768541574, 0.854711175, 0.945872426, 1.04143679, 1.14093816,
+        1.24398923, 1.35020399, 1.45919669, 1.57058132, 1.683972, 1.79898274, 1.91522777, 2.03232098,
+        2.14987659
+    },
+    0.056174
+};
+
+const WhLiteData Model7Lite = {
+    { { 0.997957587, -1.99591517, 0.997957587, -1.99591172, 0.995918572 }, { 1.35246849, -1.58125567, 0.273998171, -1.58125567, 0.626466632 } },
+    { { 0.0714736208, 0.142947242, 0.0714736208, -1.1941334, 0.480027884 }, { 1.00009179, -1.99139535, 0.991310418, -1.99139535, 0.991402149 }, { 1.04750109, -1.84818101, 0.808341861, -1.84818101, 0.855842948 } },
+    1.83299541,
+    {
+        -0.433935344, -0.443405658, -0.452666432, -0.461518914, -0.469764441, -0.477204233, -0.483639657, -0.488871962,
+        -0.492702454, -0.494932413, -0.495363146, -0.493799597, -0.490266919, -0.485131502, -0.478789151, -0.47163564,
+        -0.464066684, -0.456478089, -0.449265629, -0.442825049, -0.437552124, -0.433842659, -0.432051271, -0.432054847,
+        -0.43342194, -0.435716033, -0.438500524, -0.441338867, -0.443794519, -0.445430905, -0.44581148, -0.444499701,
+        -0.441058964, -0.43521452, -0.427338511, -0.417964846, -0.407627463, -0.396860331, -0.386197299, -0.376172334,
+        -0.367319375, -0.360172331, -0.355265081, -0.353124529, -0.35385111, -0.356884569, -0.36160779, -0.367403656,
+        -0.373654991, -0.379744709, -0.385055691, -0.388970792, -0.390872926, -0.390144885, -0.386241734, -0.37945658,
+        -0.37062335, -0.360584974, -0.350184351, -0.34026444, -0.331668168, -0.325238407, -0.321818143, -0.322250247,
+        -0.327377707, -0.337718278, -0.352489531, -0.370583773, -0.3908934, -0.412310809, -0.433728397, -0.454038531,
+        -0.472133577, -0.486905932, -0.497247994, -0.50206697, -0.501158476, -0.495695591, -0.48696959, -0.476271957,
+        -0.464894056, -0.454127312, -0.445263088, -0.439592808, -0.438407898, -0.44299975, -0.454504937, -0.472260654,
+        -0.494443148, -0.519209266, -0.544715941, -0.56911999, -0.590578318, -0.607247829, -0.61728543, -0.618847907,
+        -0.610092223, -0.589933634, -0.560320616, -0.523960054, -0.483558923, -0.441824079, -0.401462436, -0.36518088,
+        -0.335686296, -0.3156856, -0.307885706, -0.314956218, -0.337332636, -0.371987343, -0.415594876, -0.464829743,
+        -0.516366422, -0.566879511, -0.613043487, -0.651532888, -0.679022193, -0.692185879, -0.687958598, -0.666297019,
+        -0.629108012, -0.578330696, -0.515904427, -0.443768293, -0.363861591, -0.278123558, -0.188493416, -0.0969103873,
+        -0.005313701, 0.0844665468, 0.171036825, 0.253112733, 0.329409868, 0.398643851, 0.459530234, 0.510784686,
+        0.551122785, 0.579260111, 0.593912303, 0.593820333, 0.579251111, 0.552836418, 0.517411649, 0.475811988,
+        0.430872798, 0.385429323, 0.342316866, 0.304370701, 0.274426162, 0.255318522, 0.24962303, 0.256892323,
+        0.274728835, 0.300702602, 0.332383543, 0.367341667, 0.403146952, 0.437369376, 0.467578918, 0.491345555,
+        0.506239295, 0.510527074, 0.505264282, 0.492203236, 0.473096222, 0.449695587, 0.423753679, 0.397022843,
+        0.371255398, 0.348203659, 0.329620004, 0.317238957, 0.311727226, 0.312096447, 0.31721586, 0.325954705,
+        0.337182254, 0.349767685, 0.362580299, 0.374489337, 0.384364039, 0.391073614, 0.393584818, 0.391997248,
+        0.387141585, 0.37986061, 0.370997041, 0.36139375, 0.351893514, 0.343339086, 0.336573273, 0.332438886,
+        0.331778675, 0.335168928, 0.342119753, 0.351874679, 0.363677293, 0.376771152, 0.390399814, 0.403806865,
+        0.416235864, 0.426930338, 0.435133904, 0.440098524, 0.441581726, 0.440124691, 0.436335921, 0.430824041,
+        0.424197525, 0.417064995, 0.410034955, 0.403715998, 0.398716629, 0.395645469, 0.395057678, 0.396888703,
+        0.400673985, 0.40594244, 0.412222803, 0.419043988, 0.425934792, 0.432424039, 0.438040555, 0.442313194,
+        0.444770783, 0.445079654, 0.443456084, 0.440253943, 0.435826987, 0.430529058, 0.424713969, 0.418735504,
+        0.412947506, 0.407703757, 0.403358102, 0.400259972, 0.398499727, 0.397765964, 0.397712678, 0.397993922,
+        0.398263723, 0.398176134, 0.39738518, 0.395544887, 0.392309308, 0.387332439, 0.380295604, 0.371197373,
+        0.360240877, 0.347632706, 0.333579451, 0.3182877, 0.301964045, 0.284815043, 0.267047316, 0.248867407,
+        0.230481923
+    },
+    0.0568079
+};
+